@@ -0,0 +1,830 @@
+#include <cmath>
+#include "Bench.hpp"
+#include "sources/MagicalContainer.hpp"
+#include "sources/ParallelTraversal.hpp"
+#include "sources/ConcurrentMagicalContainer.hpp"
+#include "sources/SnapshotMagicalContainer.hpp"
+#include "sources/StreamLoader.hpp"
+#include "sources/StreamExport.hpp"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory_resource>
+#include <thread>
+
+using namespace bench;
+
+// Inserts timed per iteration; the container is restored to its fixture size between iterations
+const std::size_t MUTATIONS_PER_ITERATION = 1024;
+
+// Streaming ingest from an empty container must sustain this rate
+const std::size_t STREAMING_ADDS = 20000;
+const double MIN_ADDS_PER_SEC = 1e6;
+
+// Mutations interleaved into one full traversal in the mixed workload
+const std::size_t MUTATIONS_PER_TRAVERSAL = 64;
+
+static MagicalContainer makeContainer(const std::vector<int> &values) {
+    MagicalContainer container;
+    container.addElements(values.begin(), values.end());
+    return container;
+}
+
+// The trial division isPrime used to do, kept as the primality baseline
+static bool trialDivisionIsPrime(int number) {
+    if (number < 2) {
+        return false;
+    }
+    double sqrtNum = std::sqrt(number);
+    for (int i = 2; i <= sqrtNum; ++i) {
+        if (number % i == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Iterator>
+static void benchTraversal(State &state, Distribution distribution) {
+    MagicalContainer container = makeContainer(makeValues(distribution, state.size()));
+    Iterator iter(container);
+    long long steps = 0;
+    while (state.keepRunning()) {
+        long long sum = 0;
+        steps = 0;
+        for (auto it = iter.begin(); it != iter.end(); ++it) {
+            sum += *it;
+            ++steps;
+        }
+        doNotOptimize(sum);
+    }
+    state.setItemsPerIteration(steps);
+}
+
+static Registrar containerBenchmarks([] {
+    for (Distribution distribution: allDistributions()) {
+        std::string suffix = "/" + distributionName(distribution);
+
+        add("addElement" + suffix, [distribution](State &state) {
+            std::vector<int> values = makeValues(distribution, state.size());
+            MagicalContainer container = makeContainer(values);
+            std::size_t count = std::min(state.size(), MUTATIONS_PER_ITERATION);
+            std::vector<int> inserts = makeValues(distribution, count, 7);
+            while (state.keepRunning()) {
+                for (int value: inserts) {
+                    container.addElement(value);
+                }
+                state.pauseTiming();
+                container = makeContainer(values);
+                state.resumeTiming();
+            }
+            state.setItemsPerIteration(static_cast<long long>(count));
+        }, decadeSizes(), 200);
+
+        add("addElements" + suffix, [distribution](State &state) {
+            std::vector<int> values = makeValues(distribution, state.size());
+            while (state.keepRunning()) {
+                MagicalContainer container;
+                container.addElements(values.begin(), values.end());
+                doNotOptimize(container.size());
+            }
+            state.setItemsPerIteration(static_cast<long long>(state.size()));
+        }, decadeSizes());
+
+        add("removeElement" + suffix, [distribution](State &state) {
+            std::vector<int> values = makeValues(distribution, state.size());
+            MagicalContainer container = makeContainer(values);
+            std::size_t count = std::min(state.size(), MUTATIONS_PER_ITERATION);
+            std::vector<int> victims(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(count));
+            while (state.keepRunning()) {
+                for (int value: victims) {
+                    container.removeElement(value);
+                }
+                state.pauseTiming();
+                container = makeContainer(values);
+                state.resumeTiming();
+            }
+            state.setItemsPerIteration(static_cast<long long>(count));
+        }, decadeSizes(), 200);
+
+        add("ascending" + suffix, [distribution](State &state) {
+            benchTraversal<MagicalContainer::AscendingIterator>(state, distribution);
+        }, decadeSizes());
+
+        add("sideCross" + suffix, [distribution](State &state) {
+            benchTraversal<MagicalContainer::SideCrossIterator>(state, distribution);
+        }, decadeSizes());
+
+        add("prime" + suffix, [distribution](State &state) {
+            benchTraversal<MagicalContainer::PrimeIterator>(state, distribution);
+        }, decadeSizes());
+
+        // Full ascending traversal with inserts and removes spread evenly across it
+        add("mutateWhileIterating" + suffix, [distribution](State &state) {
+            MagicalContainer container = makeContainer(makeValues(distribution, state.size()));
+            auto stride = static_cast<long long>(std::max<std::size_t>(state.size() / MUTATIONS_PER_TRAVERSAL, 1));
+            MagicalContainer::AscendingIterator iter(container);
+            long long steps = 0;
+            while (state.keepRunning()) {
+                long long sum = 0;
+                std::size_t mutation = 0;
+                steps = 0;
+                for (auto it = iter.begin(); it != iter.end(); ++it) {
+                    sum += *it;
+                    // Negative values are never in the fixture, so each add/remove pair restores it exactly
+                    if (++steps % stride == 0 && mutation < MUTATIONS_PER_TRAVERSAL) {
+                        int value = -1 - static_cast<int>(mutation++);
+                        container.addElement(value);
+                        container.removeElement(value);
+                    }
+                }
+                doNotOptimize(sum);
+            }
+            state.setItemsPerIteration(steps);
+        }, decadeSizes());
+    }
+});
+
+// std::lower_bound through AscendingIterator relies on its random-access category for O(log n) probes
+static Registrar algorithmBenchmarks([] {
+    add("lowerBound/ascendingIterator", [](State &state) {
+        MagicalContainer container = makeContainer(makeValues(Distribution::Uniform, state.size()));
+        std::vector<int> probes = makeValues(Distribution::Uniform, 1024, 7);
+        MagicalContainer::AscendingIterator iter(container);
+        while (state.keepRunning()) {
+            long long found = 0;
+            for (int probe: probes) {
+                found += std::lower_bound(iter.begin(), iter.end(), probe) - iter.begin();
+            }
+            doNotOptimize(found);
+        }
+        state.setItemsPerIteration(static_cast<long long>(probes.size()));
+    }, decadeSizes());
+});
+
+// Every prime as a dense array: bulk copy of the prime index against a PrimeIterator loop
+static Registrar collectPrimesBenchmarks([] {
+    add("collectPrimes/bulk", [](State &state) {
+        MagicalContainer container = makeContainer(makeValues(Distribution::PrimeHeavy, state.size()));
+        std::vector<int> out;
+        while (state.keepRunning()) {
+            out.clear();
+            container.collectPrimes(out);
+            doNotOptimize(out.data());
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, decadeSizes());
+
+    add("collectPrimes/primeIterator", [](State &state) {
+        MagicalContainer container = makeContainer(makeValues(Distribution::PrimeHeavy, state.size()));
+        MagicalContainer::PrimeIterator iter(container);
+        std::vector<int> out;
+        while (state.keepRunning()) {
+            out.clear();
+            for (auto it = iter.begin(); it != iter.end(); ++it) {
+                out.push_back(*it);
+            }
+            doNotOptimize(out.data());
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, decadeSizes());
+});
+
+// Membership probes over uniform data, half of them hits: the container's branchless search, the same
+// through the Eytzinger index, std::lower_bound over the ascending order, and a linear scan
+static Registrar lookupBenchmarks([] {
+    auto probesFor = [](const std::vector<int> &values) {
+        std::vector<int> probes = makeValues(Distribution::Uniform, 1024, 7);
+        for (std::size_t i = 0; i < probes.size(); i += 2) {
+            probes[i] = values[static_cast<std::size_t>(probes[i]) % values.size()];
+        }
+        return probes;
+    };
+    auto lookupCase = [probesFor](bool indexed) {
+        return [probesFor, indexed](State &state) {
+            std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+            MagicalContainer container = makeContainer(values);
+            if (indexed) {
+                container.buildSearchIndex();
+            }
+            std::vector<int> probes = probesFor(values);
+            while (state.keepRunning()) {
+                int found = 0;
+                for (int probe: probes) {
+                    found += container.contains(probe) ? 1 : 0;
+                }
+                doNotOptimize(found);
+            }
+            state.setItemsPerIteration(static_cast<long long>(probes.size()));
+        };
+    };
+    add("contains/branchless", lookupCase(false), decadeSizes());
+    add("contains/eytzinger", lookupCase(true), decadeSizes());
+
+    add("contains/stdLowerBound", [probesFor](State &state) {
+        std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+        std::sort(values.begin(), values.end());
+        std::vector<int> probes = probesFor(values);
+        while (state.keepRunning()) {
+            int found = 0;
+            for (int probe: probes) {
+                auto it = std::lower_bound(values.begin(), values.end(), probe);
+                found += it != values.end() && *it == probe ? 1 : 0;
+            }
+            doNotOptimize(found);
+        }
+        state.setItemsPerIteration(static_cast<long long>(probes.size()));
+    }, decadeSizes());
+
+    add("contains/linearScan", [probesFor](State &state) {
+        std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+        MagicalContainer container = makeContainer(values);
+        std::vector<int> probes = probesFor(values);
+        MagicalContainer::AscendingIterator iter(container);
+        while (state.keepRunning()) {
+            int found = 0;
+            for (int probe: probes) {
+                found += std::find(iter.begin(), iter.end(), probe) != iter.end() ? 1 : 0;
+            }
+            doNotOptimize(found);
+        }
+        state.setItemsPerIteration(static_cast<long long>(probes.size()));
+    }, decadeSizes(100000), 20);
+});
+
+// Random jumps into the cross order, each resolved by the closed-form position mapping
+static Registrar seekBenchmarks([] {
+    add("sideCrossSeek", [](State &state) {
+        MagicalContainer container = makeContainer(makeValues(Distribution::Uniform, state.size()));
+        std::vector<int> offsets = makeValues(Distribution::Uniform, 1024, 7);
+        for (int &offset: offsets) {
+            offset %= container.size();
+        }
+        MagicalContainer::SideCrossIterator iter(container);
+        while (state.keepRunning()) {
+            long long sum = 0;
+            for (int offset: offsets) {
+                sum += *iter.seek(offset);
+            }
+            doNotOptimize(sum);
+        }
+        state.setItemsPerIteration(static_cast<long long>(offsets.size()));
+    }, decadeSizes());
+});
+
+// Miller-Rabin over every element, split across the pool; items/s should grow with the thread count
+static Registrar parallelBenchmarks([] {
+    for (unsigned threads: {1U, 2U, 4U, 8U, 16U, 32U}) {
+        add("parallelForEach/threads:" + std::to_string(threads), [threads](State &state) {
+            MagicalContainer container = makeContainer(makeValues(Distribution::Uniform, state.size()));
+            ThreadPool pool(threads);
+            while (state.keepRunning()) {
+                parallelForEach(MagicalContainer::AscendingIterator(container),
+                                [](int value) { doNotOptimize(MagicalContainer::isPrime(value)); }, pool);
+            }
+            state.setItemsPerIteration(static_cast<long long>(state.size()));
+        }, {1000000, 10000000});
+    }
+});
+
+// Readers each run full ascending traversals while one writer keeps adding and removing; items/s counts
+// elements read. Compares copy-on-write snapshots, the reader-writer lock and a single global mutex.
+const int CONCURRENT_READERS = 4;
+const int TRAVERSALS_PER_READER = 8;
+
+template<typename Container>
+static void benchConcurrentReads(State &state) {
+    Container container;
+    std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+    container.addElements(values.begin(), values.end());
+    while (state.keepRunning()) {
+        std::atomic<bool> readersDone{false};
+        std::thread writer([&container, &readersDone] {
+            for (int value = -1; !readersDone; --value) {
+                container.addElement(value);
+                container.removeElement(value);
+            }
+        });
+        std::vector<std::thread> readers;
+        for (int reader = 0; reader < CONCURRENT_READERS; ++reader) {
+            readers.emplace_back([&container] {
+                for (int traversal = 0; traversal < TRAVERSALS_PER_READER; ++traversal) {
+                    doNotOptimize(container.read([](const MagicalContainer &snapshot) {
+                        long long sum = 0;
+                        MagicalContainer::AscendingIterator iter(snapshot);
+                        for (auto it = iter.begin(); it != iter.end(); ++it) {
+                            sum += *it;
+                        }
+                        return sum;
+                    }));
+                }
+            });
+        }
+        for (std::thread &reader: readers) {
+            reader.join();
+        }
+        readersDone = true;
+        writer.join();
+    }
+    state.setItemsPerIteration(static_cast<long long>(state.size()) * CONCURRENT_READERS * TRAVERSALS_PER_READER);
+}
+
+static Registrar concurrentBenchmarks([] {
+    add("concurrentReads/snapshot", benchConcurrentReads<SnapshotMagicalContainer<int>>, decadeSizes(1000000),
+        1000);
+    add("concurrentReads/sharedMutex", benchConcurrentReads<ConcurrentMagicalContainer<int>>,
+        decadeSizes(1000000), 1000);
+    add("concurrentReads/globalMutex", benchConcurrentReads<ConcurrentMagicalContainer<int, std::mutex>>,
+        decadeSizes(1000000), 1000);
+});
+
+static Registrar streamingBenchmark([] {
+    add("streamingAdd", [](State &state) {
+        std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+        while (state.keepRunning()) {
+            MagicalContainer container;
+            for (int value: values) {
+                container.addElement(value);
+            }
+            doNotOptimize(container.size());
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, {STREAMING_ADDS}, 1000000, MIN_ADDS_PER_SEC);
+});
+
+// Thousands of single inserts followed by one traversal, with and without the write buffer
+static void benchLoadThenIterate(State &state, bool buffered) {
+    std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+    while (state.keepRunning()) {
+        MagicalContainer container;
+        container.setWriteBuffering(buffered);
+        for (int value: values) {
+            container.addElement(value);
+        }
+        MagicalContainer::AscendingIterator iter(container);
+        doNotOptimize(*iter.begin());
+    }
+    state.setItemsPerIteration(static_cast<long long>(state.size()));
+}
+
+static Registrar bufferingBenchmarks([] {
+    add("loadThenIterate/direct", [](State &state) { benchLoadThenIterate(state, false); }, decadeSizes(100000));
+    add("loadThenIterate/buffered", [](State &state) { benchLoadThenIterate(state, true); }, decadeSizes(1000000));
+});
+
+// Both storage backends head to head: random single inserts and erases into a prefilled store, then a full
+// indexed scan, which is the access pattern of the container's iterators
+template<typename Storage>
+static void registerStorageBenchmarks(const std::string &backend) {
+    auto prefilled = [](std::size_t size) {
+        std::vector<int> values = makeValues(Distribution::Uniform, size);
+        std::sort(values.begin(), values.end());
+        Storage storage;
+        storage.merge(values);
+        return storage;
+    };
+
+    add("storage/insert/" + backend, [prefilled](State &state) {
+        Storage storage = prefilled(state.size());
+        std::vector<int> inserts = makeValues(Distribution::Uniform, MUTATIONS_PER_ITERATION, 7);
+        while (state.keepRunning()) {
+            for (int value: inserts) {
+                storage.insert(value);
+            }
+            state.pauseTiming();
+            for (int value: inserts) {
+                storage.erase(value);
+            }
+            state.resumeTiming();
+        }
+        state.setItemsPerIteration(static_cast<long long>(inserts.size()));
+    }, decadeSizes(), 200);
+
+    add("storage/erase/" + backend, [prefilled](State &state) {
+        Storage storage = prefilled(state.size());
+        std::vector<int> victims = makeValues(Distribution::Uniform, MUTATIONS_PER_ITERATION, 7);
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            for (int value: victims) {
+                storage.insert(value);
+            }
+            state.resumeTiming();
+            for (int value: victims) {
+                storage.erase(value);
+            }
+        }
+        state.setItemsPerIteration(static_cast<long long>(victims.size()));
+    }, decadeSizes(), 200);
+
+    add("storage/scan/" + backend, [prefilled](State &state) {
+        Storage storage = prefilled(state.size());
+        while (state.keepRunning()) {
+            long long sum = 0;
+            for (std::size_t i = 0; i < storage.size(); ++i) {
+                sum += storage[i];
+            }
+            doNotOptimize(sum);
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, decadeSizes());
+
+    // Indexed reads alternating between the two ends, as the cross order walks
+    add("storage/crossScan/" + backend, [prefilled](State &state) {
+        Storage storage = prefilled(state.size());
+        while (state.keepRunning()) {
+            long long sum = 0;
+            for (std::size_t low = 0, high = storage.size(); low < high; ++low) {
+                sum += storage[low];
+                if (low < --high) {
+                    sum += storage[high];
+                }
+            }
+            doNotOptimize(sum);
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, decadeSizes());
+
+    // The same scan through forEachRun, which is what exports and saves use
+    add("storage/runScan/" + backend, [prefilled](State &state) {
+        Storage storage = prefilled(state.size());
+        while (state.keepRunning()) {
+            long long sum = 0;
+            storage.forEachRun([&sum](const int *run, std::size_t length) {
+                for (std::size_t i = 0; i < length; ++i) {
+                    sum += run[i];
+                }
+            });
+            doNotOptimize(sum);
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, decadeSizes());
+
+    add("storage/lowerBound/" + backend, [prefilled](State &state) {
+        Storage storage = prefilled(state.size());
+        std::vector<int> probes = makeValues(Distribution::Uniform, MUTATIONS_PER_ITERATION, 7);
+        while (state.keepRunning()) {
+            std::size_t sum = 0;
+            for (int value: probes) {
+                sum += storage.lowerBound(value);
+            }
+            doNotOptimize(sum);
+        }
+        state.setItemsPerIteration(static_cast<long long>(probes.size()));
+    }, decadeSizes());
+}
+
+static Registrar storageBenchmarks([] {
+    registerStorageBenchmarks<SortedVector<int>>("vector");
+    registerStorageBenchmarks<SortedBlocks<int>>("blocks");
+    registerStorageBenchmarks<SortedPacked<int>>("packed");
+});
+
+// Bytes a structure holds through its allocator, for the footprint benchmarks
+class FootprintResource : public std::pmr::memory_resource {
+public:
+    std::size_t liveBytes = 0;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        liveBytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override {
+        liveBytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// Bulk-builds each backend from a sorted run and reports what it then holds per element, in the B/item
+// column, next to the build rate. "uniform" spreads the values over [0, 2^30], so gaps average 2^30 / size;
+// "dense" steps by 3, the best case for delta encoding.
+template<typename Storage>
+static void registerFootprintBenchmarks(const std::string &backend) {
+    for (const std::string spread: {"uniform", "dense"}) {
+        add("footprint/" + spread + "/" + backend, [spread](State &state) {
+            std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+            if (spread == "dense") {
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    values[i] = static_cast<int>(3 * i);
+                }
+            }
+            std::sort(values.begin(), values.end());
+            FootprintResource resource;
+            while (state.keepRunning()) {
+                Storage storage{std::pmr::polymorphic_allocator<int>(&resource)};
+                storage.merge(values);
+                state.setFootprintBytes(static_cast<long long>(resource.liveBytes));
+                state.pauseTiming();
+                storage = Storage{std::pmr::polymorphic_allocator<int>(&resource)};
+                state.resumeTiming();
+            }
+            state.setItemsPerIteration(static_cast<long long>(values.size()));
+        }, decadeSizes(), 200);
+    }
+}
+
+static Registrar footprintBenchmarks([] {
+    using Allocator = std::pmr::polymorphic_allocator<int>;
+    registerFootprintBenchmarks<SortedVector<int, Allocator>>("vector");
+    registerFootprintBenchmarks<SortedBlocks<int, Allocator>>("blocks");
+    registerFootprintBenchmarks<SortedPacked<int, Allocator>>("packed");
+});
+
+// Same workload per element width: widening the element type should cost only the extra bytes moved
+template<typename T>
+static void registerWidthBenchmarks(const std::string &width) {
+    add("addElements/" + width, [](State &state) {
+        std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+        std::vector<T> wide(values.begin(), values.end());
+        while (state.keepRunning()) {
+            BasicMagicalContainer<T> container;
+            container.addElements(wide.begin(), wide.end());
+            doNotOptimize(container.size());
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, decadeSizes(1000000));
+
+    add("ascending/" + width, [](State &state) {
+        std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+        BasicMagicalContainer<T> container;
+        container.addElements(values.begin(), values.end());
+        typename BasicMagicalContainer<T>::AscendingIterator iter(container);
+        while (state.keepRunning()) {
+            T sum = 0;
+            for (auto it = iter.begin(); it != iter.end(); ++it) {
+                sum += *it;
+            }
+            doNotOptimize(sum);
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, decadeSizes(1000000));
+}
+
+static Registrar widthBenchmarks([] {
+    registerWidthBenchmarks<std::int32_t>("int32");
+    registerWidthBenchmarks<std::int64_t>("int64");
+    registerWidthBenchmarks<std::uint64_t>("uint64");
+});
+
+// Cold start: rebuilding a container from raw values against reopening one saved with save(), with and
+// without the checksum pass, and reopening followed by a full traversal of the mapped pages. The file
+// stays in the page cache between iterations, so the open cases measure mapping, not disk reads.
+static void benchColdStart(State &state, bool rebuild, bool verify, bool traverse) {
+    std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+    std::string path = (std::filesystem::temp_directory_path() / "magical_container_bench.bin").string();
+    makeContainer(values).save(path);
+    while (state.keepRunning()) {
+        MagicalContainer container = rebuild ? makeContainer(values) : MagicalContainer::open(path, verify);
+        if (traverse) {
+            long long sum = 0;
+            MagicalContainer::AscendingIterator iter(container);
+            for (int value: iter) {
+                sum += value;
+            }
+            doNotOptimize(sum);
+        }
+        doNotOptimize(container.size());
+    }
+    std::remove(path.c_str());
+    state.setItemsPerIteration(static_cast<long long>(state.size()));
+}
+
+static Registrar coldStartBenchmarks([] {
+    add("coldStart/rebuild", [](State &state) { benchColdStart(state, true, false, false); }, decadeSizes());
+    add("coldStart/open", [](State &state) { benchColdStart(state, false, true, false); }, decadeSizes());
+    add("coldStart/openUnverified", [](State &state) { benchColdStart(state, false, false, false); },
+        decadeSizes());
+    add("coldStart/openAndTraverse", [](State &state) { benchColdStart(state, false, false, true); },
+        decadeSizes());
+});
+
+// Ingest of a file of uniform ints: the naive std::cin >> x; addElement(x) loop against the streaming loader
+// reading the same values as newline-separated text and as raw binary. The file stays in the page cache.
+static void benchLoad(State &state, bool naive, LoadFormat format) {
+    std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+    std::string path = (std::filesystem::temp_directory_path() / "magical_loader_bench.dat").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (format == LoadFormat::Text) {
+            for (int value: values) {
+                out << value << '\n';
+            }
+        } else {
+            out.write(reinterpret_cast<const char *>(values.data()),
+                      static_cast<std::streamsize>(values.size() * sizeof(int)));
+        }
+    }
+    auto bytes = static_cast<long long>(std::filesystem::file_size(path));
+    while (state.keepRunning()) {
+        MagicalContainer container;
+        if (naive) {
+            std::ifstream in(path);
+            std::streambuf *saved = std::cin.rdbuf(in.rdbuf());
+            int value = 0;
+            while (std::cin >> value) {
+                container.addElement(value);
+            }
+            std::cin.rdbuf(saved);
+            std::cin.clear();
+        } else {
+            loadFromFile(container, path, format);
+        }
+        doNotOptimize(container.size());
+    }
+    std::remove(path.c_str());
+    state.setItemsPerIteration(static_cast<long long>(state.size()));
+    state.setBytesPerIteration(bytes);
+}
+
+static Registrar loadBenchmarks([] {
+    add("load/naiveCin", [](State &state) { benchLoad(state, true, LoadFormat::Text); }, decadeSizes(100000));
+    add("load/text", [](State &state) { benchLoad(state, false, LoadFormat::Text); }, decadeSizes());
+    add("load/binary", [](State &state) { benchLoad(state, false, LoadFormat::Binary); }, decadeSizes());
+});
+
+// Exporting each order to /dev/null, which isolates the user-space cost: the Demo-style iterator loop
+// printing through std::cout against exportToDescriptor in text and binary, and an iterator loop copying
+// into a vector against exportTo into a span
+static void benchExport(State &state, MagicalOrder order, const std::string &method) {
+    MagicalContainer container = makeContainer(makeValues(Distribution::PrimeHeavy, state.size()));
+    std::vector<int> out(state.size());
+    std::ofstream devNull("/dev/null");
+    std::FILE *sink = std::fopen("/dev/null", "w");
+    auto iterate = [&container, order](auto visit) {
+        auto walk = [&visit](auto iter) {
+            for (auto it = iter.begin(); it != iter.end(); ++it) {
+                visit(*it);
+            }
+        };
+        if (order == MagicalOrder::Ascending) {
+            walk(MagicalContainer::AscendingIterator(container));
+        } else if (order == MagicalOrder::SideCross) {
+            walk(MagicalContainer::SideCrossIterator(container));
+        } else {
+            walk(MagicalContainer::PrimeIterator(container));
+        }
+    };
+    std::size_t values = 0;
+    while (state.keepRunning()) {
+        if (method == "iteratorCout") {
+            std::streambuf *saved = std::cout.rdbuf(devNull.rdbuf());
+            iterate([](int value) { std::cout << value << ' '; });
+            std::cout.rdbuf(saved);
+        } else if (method == "iteratorCopy") {
+            std::size_t index = 0;
+            iterate([&out, &index](int value) { out[index++] = value; });
+            values = index;
+        } else if (method == "span") {
+            values = container.exportTo(out, order);
+        } else {
+            values = exportToDescriptor(container, fileno(sink), order,
+                                        method == "text" ? LoadFormat::Text : LoadFormat::Binary);
+        }
+        doNotOptimize(out.data());
+    }
+    std::fclose(sink);
+    doNotOptimize(values);
+    state.setItemsPerIteration(static_cast<long long>(state.size()));
+}
+
+static Registrar exportBenchmarks([] {
+    const std::vector<std::pair<std::string, MagicalOrder>> orders{
+            {"ascending", MagicalOrder::Ascending}, {"sideCross", MagicalOrder::SideCross}, {"prime", MagicalOrder::Prime}};
+    for (const auto &[orderName, order]: orders) {
+        for (const std::string method: {"iteratorCout", "text", "binary", "iteratorCopy", "span"}) {
+            add("export/" + orderName + "/" + method,
+                [order = order, method](State &state) { benchExport(state, order, method); }, decadeSizes());
+        }
+    }
+});
+
+// Short-lived containers as a request handler uses them: create, fill with a batch and a few single
+// inserts, walk the ascending and prime orders, destroy. The default heap against a monotonic arena
+// released after each container and an unsynchronized pool resource, both reused across iterations.
+// Values stay below 41^2, where trial division settles primality, so allocation is not drowned out.
+template<typename Container>
+static void containerLifecycle(const std::vector<int> &values, const typename Container::allocator_type &allocator) {
+    Container container(allocator);
+    container.addElements(values.begin(), values.end() - 4);
+    for (auto value = values.end() - 4; value != values.end(); ++value) {
+        container.addElement(*value);
+    }
+    long long sum = 0;
+    typename Container::AscendingIterator ascIter(container);
+    for (int value: ascIter) {
+        sum += value;
+    }
+    typename Container::PrimeIterator primeIter(container);
+    for (int value: primeIter) {
+        sum += value;
+    }
+    doNotOptimize(sum);
+}
+
+static void benchLifecycle(State &state, const std::string &resource) {
+    std::vector<int> values = makeValues(Distribution::Uniform, state.size() + 4);
+    for (int &value: values) {
+        value %= 41 * 41;
+    }
+    std::vector<std::byte> buffer(64 * (state.size() + 4) + 4096);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+    std::pmr::unsynchronized_pool_resource pool;
+    while (state.keepRunning()) {
+        if (resource == "heap") {
+            containerLifecycle<MagicalContainer>(values, {});
+        } else if (resource == "monotonic") {
+            containerLifecycle<PmrMagicalContainer>(values, &arena);
+            arena.release();
+        } else {
+            containerLifecycle<PmrMagicalContainer>(values, &pool);
+        }
+    }
+    state.setItemsPerIteration(static_cast<long long>(values.size()));
+}
+
+static Registrar lifecycleBenchmarks([] {
+    const std::vector<std::size_t> sizes{16, 64, 256, 1024, 16384};
+    for (const std::string resource: {"heap", "monotonic", "pool"}) {
+        add("lifecycle/" + resource, [resource](State &state) { benchLifecycle(state, resource); }, sizes);
+    }
+});
+
+// The Demo.cpp workload: five single inserts, all three traversals, one removal, destroy; size is the
+// number of containers per iteration. Build with -DMAGICAL_CONTAINER_INLINE_CAPACITY=0 for the heap
+// baseline. smallStorage/* compares the flat vector backend with and without inline slots directly.
+static Registrar smallContainerBenchmarks([] {
+    add("demoWorkload", [](State &state) {
+        while (state.keepRunning()) {
+            for (std::size_t i = 0; i < state.size(); ++i) {
+                MagicalContainer container;
+                for (int value: {17, 2, 25, 9, 3}) {
+                    container.addElement(value);
+                }
+                int sum = 0;
+                MagicalContainer::AscendingIterator ascIter(container);
+                for (int value: ascIter) {
+                    sum += value;
+                }
+                MagicalContainer::SideCrossIterator crossIter(container);
+                for (int value: crossIter) {
+                    sum += value;
+                }
+                MagicalContainer::PrimeIterator primeIter(container);
+                for (int value: primeIter) {
+                    sum += value;
+                }
+                container.removeElement(9);
+                doNotOptimize(sum + container.size());
+            }
+        }
+        state.setItemsPerIteration(static_cast<long long>(state.size()));
+    }, {1, 1000});
+
+    auto smallStorage = [](auto storage) {
+        return [storage](State &state) {
+            std::vector<int> values = makeValues(Distribution::Uniform, state.size());
+            while (state.keepRunning()) {
+                auto filled = storage;
+                for (int value: values) {
+                    filled.insert(value);
+                }
+                doNotOptimize(filled.back());
+            }
+            state.setItemsPerIteration(static_cast<long long>(state.size()));
+        };
+    };
+    add("smallStorage/heap", smallStorage(SortedVector<int>()), {4, 16, 64});
+    add("smallStorage/inline16", smallStorage(SortedVector<int, std::allocator<int>, 16>()), {4, 16, 64});
+});
+
+// Primality kernels on values drawn uniformly from [size, 2 * size)
+static Registrar primalityBenchmarks([] {
+    const std::vector<std::size_t> magnitudes{1000, 1000000, 1U << 24U, 1U << 30U};
+    auto primalityCase = [](bool (*isPrime)(int)) {
+        return [isPrime](State &state) {
+            auto low = static_cast<int>(state.size());
+            std::vector<int> values = makeValues(Distribution::Uniform, 4096);
+            for (int &value: values) {
+                value = low + value % low;
+            }
+            while (state.keepRunning()) {
+                int primeCount = 0;
+                for (int value: values) {
+                    primeCount += isPrime(value) ? 1 : 0;
+                }
+                doNotOptimize(primeCount);
+            }
+            state.setItemsPerIteration(static_cast<long long>(values.size()));
+        };
+    };
+    add("isPrime/trialDivision", primalityCase(trialDivisionIsPrime), magnitudes);
+    add("isPrime/millerRabin", primalityCase([](int value) { return MagicalContainer::isPrime(value); }),
+        magnitudes);
+});
@@ -0,0 +1,103 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Timing state handed to a benchmark body, which wraps each timed operation in keepRunning()
+class State {
+private:
+    std::size_t range;
+    long long maxIterations;
+    double minSeconds;
+    long long iterations = 0;
+    double elapsed = 0;
+    bool timing = false;
+    std::chrono::steady_clock::time_point start;
+    long long items = 0;
+    long long bytes = 0;
+    long long footprint = 0;
+
+public:
+    State(std::size_t range, long long maxIterations, double minSeconds);
+
+    // Returns true while the body should run another iteration
+    bool keepRunning();
+
+    // Excludes fixture setup/teardown inside the loop from the measurement
+    void pauseTiming();
+
+    void resumeTiming();
+
+    [[nodiscard]] std::size_t size() const { return range; }
+
+    // Items handled per iteration, used for the items/s column
+    void setItemsPerIteration(long long count) { items = count; }
+
+    // Input bytes consumed per iteration, used for the MB/s column
+    void setBytesPerIteration(long long count) { bytes = count; }
+
+    // Bytes the structure under test occupies, reported per item in a B/item column
+    void setFootprintBytes(long long count) { footprint = count; }
+
+    [[nodiscard]] long long iterationCount() const { return iterations; }
+
+    [[nodiscard]] double seconds() const { return elapsed; }
+
+    [[nodiscard]] long long itemsPerIteration() const { return items; }
+
+    [[nodiscard]] long long bytesPerIteration() const { return bytes; }
+
+    [[nodiscard]] long long footprintBytes() const { return footprint; }
+};
+
+struct Case {
+    std::string name;
+    std::function<void(State &)> body;
+    std::vector<std::size_t> sizes;
+    long long maxIterations;
+    double minItemsPerSecond;  // 0 means no throughput target
+};
+
+std::vector<Case> &registry();
+
+void add(const std::string &name, std::function<void(State &)> body, std::vector<std::size_t> sizes,
+         long long maxIterations = 1000000, double minItemsPerSecond = 0);
+
+enum class Distribution {
+    Uniform,         // uniform over [0, 2^30]
+    PrimeHeavy,      // nine in ten values drawn from the primes below 2^24
+    DuplicateHeavy,  // only 16 distinct values
+    Sorted,          // uniform values in ascending order
+    Reverse          // uniform values in descending order
+};
+
+const std::vector<Distribution> &allDistributions();
+
+std::string distributionName(Distribution distribution);
+
+std::vector<int> makeValues(Distribution distribution, std::size_t count, std::uint32_t seed = 42);
+
+// 10, 100, ... up to and including max
+std::vector<std::size_t> decadeSizes(std::size_t max = 10000000);
+
+// Keeps the compiler from discarding a computed value
+template<typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs the callable at static-initialization time so benchmark files can register themselves
+struct Registrar {
+    explicit Registrar(const std::function<void()> &registerCases) { registerCases(); }
+};
+
+}  // namespace bench
+
+#endif  // BENCH_H
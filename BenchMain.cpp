@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include "Bench.hpp"
+#include "sources/PrimalityOracle.hpp"
+
+using namespace bench;
+
+State::State(std::size_t range, long long maxIterations, double minSeconds)
+        : range(range), maxIterations(maxIterations), minSeconds(minSeconds) {}
+
+bool State::keepRunning() {
+    pauseTiming();
+    if (iterations >= maxIterations || (iterations > 0 && elapsed >= minSeconds)) {
+        return false;
+    }
+    ++iterations;
+    resumeTiming();
+    return true;
+}
+
+void State::pauseTiming() {
+    if (timing) {
+        std::chrono::duration<double> lap = std::chrono::steady_clock::now() - start;
+        elapsed += lap.count();
+        timing = false;
+    }
+}
+
+void State::resumeTiming() {
+    timing = true;
+    start = std::chrono::steady_clock::now();
+}
+
+std::vector<Case> &bench::registry() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+void bench::add(const std::string &name, std::function<void(State &)> body, std::vector<std::size_t> sizes,
+                long long maxIterations, double minItemsPerSecond) {
+    registry().push_back({name, std::move(body), std::move(sizes), maxIterations, minItemsPerSecond});
+}
+
+const std::vector<Distribution> &bench::allDistributions() {
+    static const std::vector<Distribution> distributions{Distribution::Uniform, Distribution::PrimeHeavy,
+                                                         Distribution::DuplicateHeavy, Distribution::Sorted,
+                                                         Distribution::Reverse};
+    return distributions;
+}
+
+std::string bench::distributionName(Distribution distribution) {
+    switch (distribution) {
+        case Distribution::Uniform:
+            return "uniform";
+        case Distribution::PrimeHeavy:
+            return "primeHeavy";
+        case Distribution::DuplicateHeavy:
+            return "duplicateHeavy";
+        case Distribution::Sorted:
+            return "sorted";
+        case Distribution::Reverse:
+            return "reverse";
+    }
+    return "unknown";
+}
+
+static const std::vector<int> &smallPrimes() {
+    static const std::vector<int> primes = [] {
+        const int limit = 1 << 24;
+        PrimalityOracle oracle;
+        oracle.cover(0, limit);
+        std::vector<int> found;
+        for (int value = 2; value < limit; ++value) {
+            if (oracle.isPrime(value)) {
+                found.push_back(value);
+            }
+        }
+        return found;
+    }();
+    return primes;
+}
+
+std::vector<int> bench::makeValues(Distribution distribution, std::size_t count, std::uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> uniform(0, 1 << 30);
+    std::vector<int> values(count);
+    switch (distribution) {
+        case Distribution::PrimeHeavy: {
+            const std::vector<int> &primes = smallPrimes();
+            std::uniform_int_distribution<std::size_t> pick(0, primes.size() - 1);
+            std::uniform_int_distribution<int> tenth(0, 9);
+            for (int &value: values) {
+                value = tenth(gen) == 0 ? uniform(gen) : primes[pick(gen)];
+            }
+            break;
+        }
+        case Distribution::DuplicateHeavy: {
+            std::uniform_int_distribution<int> few(0, 15);
+            for (int &value: values) {
+                value = few(gen);
+            }
+            break;
+        }
+        default:
+            for (int &value: values) {
+                value = uniform(gen);
+            }
+    }
+    if (distribution == Distribution::Sorted) {
+        std::sort(values.begin(), values.end());
+    } else if (distribution == Distribution::Reverse) {
+        std::sort(values.rbegin(), values.rend());
+    }
+    return values;
+}
+
+std::vector<std::size_t> bench::decadeSizes(std::size_t max) {
+    std::vector<std::size_t> sizes;
+    for (std::size_t size = 10; size <= max; size *= 10) {
+        sizes.push_back(size);
+    }
+    return sizes;
+}
+
+struct Result {
+    std::string name;
+    long long iterations;
+    double nsPerIteration;
+    double itemsPerSecond;
+    double bytesPerSecond;
+    double footprintPerItem;
+    bool belowTarget;
+};
+
+static std::string jsonReport(const std::vector<Result> &results) {
+    std::time_t now = std::time(nullptr);
+    std::ostringstream out;
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << std::put_time(std::localtime(&now), "%Y-%m-%dT%H:%M:%S") << "\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << "\n  },\n"
+        << "  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+            << ", \"real_time\": " << result.nsPerIteration << ", \"time_unit\": \"ns\""
+            << ", \"items_per_second\": " << result.itemsPerSecond
+            << (result.bytesPerSecond > 0 ? ", \"bytes_per_second\": " + std::to_string(result.bytesPerSecond) : "")
+            << (result.footprintPerItem > 0 ? ", \"footprint_bytes_per_item\": " + std::to_string(result.footprintPerItem) : "")
+            << ", \"below_target\": " << (result.belowTarget ? "true" : "false") << "}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+// Flags follow Google Benchmark's spelling so existing tooling can drive the binary
+int main(int argc, char **argv) {
+    std::regex filter(".*");
+    std::string format = "console";
+    std::string outPath;
+    double minSeconds = 0.1;
+    std::size_t maxSize = 10000000;
+    // Missed throughput targets are always reported, but only fail the run when asked, since they depend on the host
+    bool enforceTargets = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = arg.substr(arg.find('=') + 1);
+        if (arg.rfind("--benchmark_filter=", 0) == 0) {
+            filter = std::regex(value);
+        } else if (arg.rfind("--benchmark_format=", 0) == 0) {
+            format = value;
+        } else if (arg.rfind("--benchmark_out=", 0) == 0) {
+            outPath = value;
+        } else if (arg.rfind("--benchmark_min_time=", 0) == 0) {
+            minSeconds = std::stod(value);
+        } else if (arg.rfind("--max_size=", 0) == 0) {
+            maxSize = std::stoul(value);
+        } else if (arg == "--benchmark_enforce_targets") {
+            enforceTargets = true;
+        } else {
+            std::cerr << "Unknown flag: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    bool console = format != "json";
+    for (const Case &benchCase: registry()) {
+        for (std::size_t size: benchCase.sizes) {
+            std::string name = benchCase.name + "/" + std::to_string(size);
+            if (size > maxSize || !std::regex_search(name, filter)) {
+                continue;
+            }
+            State state(size, benchCase.maxIterations, minSeconds);
+            benchCase.body(state);
+
+            double seconds = state.seconds();
+            long long iterations = state.iterationCount();
+            double itemsPerSecond = seconds > 0 ? static_cast<double>(state.itemsPerIteration() * iterations) / seconds : 0;
+            double bytesPerSecond = seconds > 0 ? static_cast<double>(state.bytesPerIteration() * iterations) / seconds : 0;
+            double footprintPerItem = state.itemsPerIteration() > 0
+                                      ? static_cast<double>(state.footprintBytes()) / static_cast<double>(state.itemsPerIteration())
+                                      : 0;
+            bool belowTarget = benchCase.minItemsPerSecond > 0 && itemsPerSecond < benchCase.minItemsPerSecond;
+            results.push_back({name, iterations, iterations > 0 ? seconds * 1e9 / static_cast<double>(iterations) : 0,
+                               itemsPerSecond, bytesPerSecond, footprintPerItem, belowTarget});
+
+            if (console) {
+                std::cout << std::left << std::setw(44) << name << std::right << std::setw(16) << std::fixed
+                          << std::setprecision(0) << results.back().nsPerIteration << " ns" << std::setw(12)
+                          << iterations << std::setw(16) << std::setprecision(3) << std::scientific
+                          << itemsPerSecond << " items/s";
+                if (bytesPerSecond > 0) {
+                    std::cout << std::setw(12) << std::fixed << std::setprecision(1) << bytesPerSecond / 1e6 << " MB/s";
+                }
+                if (footprintPerItem > 0) {
+                    std::cout << std::setw(10) << std::fixed << std::setprecision(2) << footprintPerItem << " B/item";
+                }
+                std::cout << (belowTarget ? "  BELOW TARGET" : "") << std::endl;
+                std::cout.unsetf(std::ios::floatfield);
+            }
+        }
+    }
+
+    if (!console) {
+        std::cout << jsonReport(results);
+    }
+    if (!outPath.empty()) {
+        std::ofstream(outPath) << jsonReport(results);
+    }
+
+    for (const Result &result: results) {
+        if (enforceTargets && result.belowTarget) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,7 +1,20 @@
 #include "doctest.h"
 #include "sources/MagicalContainer.hpp"
+#include "sources/ParallelTraversal.hpp"
+#include "sources/ConcurrentMagicalContainer.hpp"
+#include "sources/SnapshotMagicalContainer.hpp"
+#include "sources/StreamLoader.hpp"
+#include "sources/StreamExport.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
 #include <stdexcept>
+#include <string>
+#include <thread>
 
 TEST_CASE("AscendingIterator Traversal") {
     MagicalContainer container;
@@ -311,6 +324,25 @@ TEST_CASE("SideCrossIterator Begin and End Pointers") {
     CHECK_EQ(count, 3);
 }
 
+TEST_CASE("SideCrossIterator Reaches End at Either Parity") {
+    for (int size = 1; size <= 6; ++size) {
+        MagicalContainer container;
+        for (int value = 1; value <= size; ++value) {
+            container.addElement(value);
+        }
+        MagicalContainer::SideCrossIterator crossIter(container);
+
+        int count = 0;
+        auto it = crossIter.begin();
+        for (; it != crossIter.end() && count <= size; ++it) {
+            ++count;
+        }
+        CHECK_EQ(count, size);
+        CHECK_EQ(it, crossIter.end());
+        CHECK_THROWS(*it);
+    }
+}
+
 TEST_CASE("PrimeIterator Begin and End Pointers") {
     MagicalContainer container;
     container.addElement(5);
@@ -341,9 +373,10 @@ TEST_CASE("SideCrossIterator Dereference Operator") {
     container.addElement(5);
     container.addElement(2);
     MagicalContainer::SideCrossIterator crossIter(container);
-    CHECK_EQ(*crossIter, 5);
-    ++crossIter;
+    // One from the start, then one from the end
     CHECK_EQ(*crossIter, 2);
+    ++crossIter;
+    CHECK_EQ(*crossIter, 5);
 }
 
 TEST_CASE("PrimeIterator Dereference Operator") {
@@ -555,3 +588,1054 @@ TEST_CASE("Add Element while Iterating - PrimeIterator") {
     CHECK_THROWS(*primeIter);
 }
 
+
+TEST_CASE("Bulk Add Elements") {
+    MagicalContainer container;
+    container.addElement(4);
+    container.addElement(10);
+
+    std::vector<int> batch{7, 1, 10, 3};
+    container.addElements(batch.begin(), batch.end());
+    CHECK_EQ(container.size(), 6);
+
+    MagicalContainer::AscendingIterator ascIter(container);
+    std::vector<int> elements;
+    for (auto it = ascIter.begin(); it != ascIter.end(); ++it) {
+        elements.push_back(*it);
+    }
+    std::vector<int> expected{1, 3, 4, 7, 10, 10};
+    CHECK_EQ(elements, expected);
+
+    container.addElements({});
+    CHECK_EQ(container.size(), 6);
+}
+
+TEST_CASE("Bulk Remove Elements") {
+    MagicalContainer container;
+    std::vector<int> batch{5, 2, 10, 7, 3, 9, 7};
+    container.addElements(batch.begin(), batch.end());
+
+    std::vector<int> victims{9, 7, 42, 2};
+    container.removeElements(victims.begin(), victims.end());
+    CHECK_EQ(container.size(), 3);
+
+    MagicalContainer::AscendingIterator ascIter(container);
+    std::vector<int> elements;
+    for (auto it = ascIter.begin(); it != ascIter.end(); ++it) {
+        elements.push_back(*it);
+    }
+    std::vector<int> expected{3, 5, 10};
+    CHECK_EQ(elements, expected);
+
+    container.removeElement(42);
+    CHECK_EQ(container.size(), 3);
+    container.removeElement(5);
+    CHECK_EQ(container.size(), 2);
+}
+
+TEST_CASE("PrimeIterator Skips Leading Non-Primes") {
+    MagicalContainer container;
+    std::vector<int> batch{1, 4, 7, 9, 11, 13};
+    container.addElements(batch.begin(), batch.end());
+
+    MagicalContainer::PrimeIterator primeIter(container);
+    std::vector<int> elements;
+    for (auto it = primeIter.begin(); it != primeIter.end(); ++it) {
+        elements.push_back(*it);
+    }
+    std::vector<int> expected{7, 11, 13};
+    CHECK_EQ(elements, expected);
+
+    container.removeElements(std::vector<int>{11, 4});
+    container.addElement(2);
+    elements.clear();
+    for (auto it = primeIter.begin(); it != primeIter.end(); ++it) {
+        elements.push_back(*it);
+    }
+    expected = {2, 7, 13};
+    CHECK_EQ(elements, expected);
+}
+
+TEST_CASE("Primality Test") {
+    CHECK_FALSE(MagicalContainer::isPrime(-7));
+    CHECK_FALSE(MagicalContainer::isPrime(1));
+    CHECK(MagicalContainer::isPrime(2));
+    CHECK(MagicalContainer::isPrime(61));
+    CHECK_FALSE(MagicalContainer::isPrime(561));         // Carmichael number
+    CHECK_FALSE(MagicalContainer::isPrime(25326001));    // strong pseudoprime to bases 2, 3 and 5
+    CHECK(MagicalContainer::isPrime(2147483647));
+    CHECK_FALSE(MagicalContainer::isPrime(2147483645));
+
+    CHECK(MagicalContainer::isPrime64(4294967291ULL));
+    CHECK_FALSE(MagicalContainer::isPrime64(3215031751ULL)); // strong pseudoprime to bases 2, 3, 5 and 7
+    CHECK(MagicalContainer::isPrime64(2305843009213693951ULL));
+    CHECK_FALSE(MagicalContainer::isPrime64(4294967291ULL * 4294967279ULL));
+    CHECK(MagicalContainer::isPrime64(18446744073709551557ULL));
+}
+
+TEST_CASE("Dense Bulk Load Prime Order") {
+    MagicalContainer container;
+    std::vector<int> batch;
+    for (int i = 100; i >= 0; --i) {
+        batch.push_back(i);
+    }
+    container.addElements(batch.begin(), batch.end());
+    container.addElement(97);
+    container.addElement(1000003);
+
+    std::vector<int> expected{2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79,
+                              83, 89, 97, 97, 1000003};
+    MagicalContainer::PrimeIterator primeIter(container);
+    std::vector<int> elements;
+    for (auto it = primeIter.begin(); it != primeIter.end(); ++it) {
+        elements.push_back(*it);
+    }
+    CHECK_EQ(elements, expected);
+}
+
+TEST_CASE("Container Stats") {
+    MagicalContainer container;
+    container.addElement(5);
+    container.addElement(2);
+    std::vector<int> batch{10, 7};
+    container.addElements(batch.begin(), batch.end());
+    container.removeElement(10);
+
+    MagicalContainer::PrimeIterator primeIter(container);
+    auto it = primeIter.begin();
+    ++it;
+    ++it;
+    ++it;
+    CHECK_THROWS(*it);
+
+    MagicalContainerStats stats = container.stats();
+#ifdef MAGICAL_CONTAINER_STATS
+    CHECK_EQ(stats.inserts, 4);
+    CHECK_EQ(stats.removes, 1);
+    CHECK_EQ(stats.sorts, 1);
+    CHECK_EQ(stats.primalityTests + stats.primalityCached, 4);
+    CHECK_EQ(stats.iteratorIncrements, 3);
+    CHECK_EQ(stats.boundsExceptions, 1);
+#else
+    CHECK_EQ(stats.inserts, 0);
+    CHECK_EQ(stats.iteratorIncrements, 0);
+    CHECK_EQ(stats.boundsExceptions, 0);
+#endif
+}
+
+TEST_CASE("64-bit Element Types") {
+    BasicMagicalContainer<std::uint64_t> ids;
+    ids.addElement(18446744073709551557ULL);  // largest 64-bit prime
+    ids.addElement(4294967296ULL);
+    ids.addElement(18446744073709551615ULL);
+    std::vector<std::uint64_t> batch{3, 4294967291ULL, 4294967291ULL * 4294967279ULL};
+    ids.addElements(batch.begin(), batch.end());
+    CHECK_EQ(ids.size(), 6);
+
+    BasicMagicalContainer<std::uint64_t>::AscendingIterator ascIter(ids);
+    CHECK_EQ(*ascIter, 3);
+    std::vector<std::uint64_t> primes;
+    BasicMagicalContainer<std::uint64_t>::PrimeIterator primeIter(ids);
+    for (auto it = primeIter.begin(); it != primeIter.end(); ++it) {
+        primes.push_back(*it);
+    }
+    std::vector<std::uint64_t> expected{3, 4294967291ULL, 18446744073709551557ULL};
+    CHECK_EQ(primes, expected);
+
+    BasicMagicalContainer<std::int64_t> wide;
+    std::vector<std::int64_t> signedBatch{-7, 2, 9007199254740881LL, 9007199254740883LL};
+    wide.addElements(signedBatch.begin(), signedBatch.end());
+    BasicMagicalContainer<std::int64_t>::PrimeIterator widePrimes(wide);
+    CHECK_EQ(*widePrimes, 2);
+    ++widePrimes;
+    CHECK_EQ(*widePrimes, 9007199254740881LL);
+    ++widePrimes;
+    CHECK_EQ(widePrimes, widePrimes.end());
+}
+
+TEST_CASE("Iterators with Standard Algorithms") {
+    MagicalContainer container;
+    std::vector<int> batch{1, 2, 4, 5, 14};
+    container.addElements(batch.begin(), batch.end());
+
+    MagicalContainer::AscendingIterator ascIter(container);
+    CHECK_EQ(std::distance(ascIter.begin(), ascIter.end()), 5);
+    CHECK_EQ(*std::lower_bound(ascIter.begin(), ascIter.end(), 5), 5);
+    CHECK_EQ(ascIter[4], 14);
+    CHECK_EQ(*(ascIter.end() - 1), 14);
+
+    MagicalContainer::SideCrossIterator crossIter(container);
+    std::vector<int> cross(crossIter.begin(), crossIter.end());
+    std::vector<int> expectedCross{1, 14, 2, 5, 4};
+    CHECK_EQ(cross, expectedCross);
+    CHECK_EQ(crossIter.end() - crossIter.begin(), 5);
+    CHECK_EQ(*(crossIter.begin() + 3), 5);
+    CHECK_EQ(crossIter.begin()[2], 2);
+    CHECK_GT(crossIter.begin() + 3, crossIter.begin() + 1);
+
+    MagicalContainer::PrimeIterator primeIter(container);
+    CHECK_EQ(std::ranges::distance(primeIter), 2);
+    CHECK_EQ(std::ranges::count_if(primeIter, [](int value) { return value > 2; }), 1);
+
+    auto it = ascIter.begin();
+    CHECK_EQ(*it++, 1);
+    CHECK_EQ(*it, 2);
+    CHECK_EQ(*--it, 1);
+}
+
+TEST_CASE("SideCrossIterator Seek and Chunks") {
+    MagicalContainer container;
+    std::vector<int> batch{1, 2, 3, 4, 5, 6, 7};
+    container.addElements(batch.begin(), batch.end());
+    MagicalContainer::SideCrossIterator crossIter(container);
+
+    CHECK_EQ(*crossIter.seek(0), 1);
+    CHECK_EQ(*crossIter.seek(5), 5);
+    CHECK_EQ(*crossIter.seek(6), 4);
+    CHECK_EQ(crossIter.seek(7), crossIter.end());
+    CHECK_EQ(crossIter.seek(5).position(), 5);
+    CHECK_THROWS(*crossIter.seek(7));
+
+    // Three consumers each walk a disjoint slice of the cross order
+    std::vector<int> joined;
+    auto total = crossIter.end() - crossIter.begin();
+    for (int chunk = 0; chunk < 3; ++chunk) {
+        auto first = crossIter.begin() + total * chunk / 3;
+        auto last = crossIter.begin() + total * (chunk + 1) / 3;
+        joined.insert(joined.end(), first, last);
+    }
+    std::vector<int> expected{1, 7, 2, 6, 3, 5, 4};
+    CHECK_EQ(joined, expected);
+}
+
+TEST_CASE("Parallel Traversal") {
+    MagicalContainer container;
+    std::vector<int> batch;
+    for (int i = 1; i <= 100; ++i) {
+        batch.push_back(i);
+    }
+    container.addElements(batch.begin(), batch.end());
+
+    MagicalContainer::PrimeIterator primeIter(container);
+    auto chunks = partitionTraversal(primeIter, 4);
+    REQUIRE_EQ(chunks.size(), 4);
+    CHECK_EQ(chunks.front().first, primeIter.begin());
+    CHECK_EQ(chunks.back().second, primeIter.end());
+    for (const auto &chunk: chunks) {
+        CHECK_GE(chunk.second - chunk.first, 6);
+        CHECK_LE(chunk.second - chunk.first, 7);
+    }
+    CHECK_EQ(partitionTraversal(primeIter, 50).size(), 25);
+
+    ThreadPool pool(4);
+    std::atomic<long long> sum{0};
+    parallelForEach(MagicalContainer::SideCrossIterator(container), [&sum](int value) { sum += value; }, pool, 7);
+    CHECK_EQ(sum, 5050);
+
+    MagicalContainer empty;
+    parallelForEach(MagicalContainer::AscendingIterator(empty), [](int) { FAIL("called on empty container"); }, pool);
+    CHECK_THROWS_AS(parallelForEach(MagicalContainer::AscendingIterator(container), [](int value) {
+        if (value == 42) {
+            throw std::runtime_error("stop");
+        }
+    }, pool), std::runtime_error);
+}
+
+TEST_CASE("Thread Pool Shared by Several Callers") {
+    ThreadPool pool(4);
+    const int rounds = 200;
+    std::atomic<int> failingCaught{0};
+    std::atomic<int> cleanCaught{0};
+    std::atomic<int> cleanTasks{0};
+    std::thread failing([&] {
+        for (int round = 0; round < rounds; ++round) {
+            try {
+                pool.run({[] { throw std::runtime_error("batch failed"); }, [] {}});
+            } catch (const std::runtime_error &) {
+                ++failingCaught;
+            }
+        }
+    });
+    std::thread clean([&] {
+        for (int round = 0; round < rounds; ++round) {
+            try {
+                pool.run({[&cleanTasks] { ++cleanTasks; }, [&cleanTasks] { ++cleanTasks; }});
+            } catch (const std::runtime_error &) {
+                ++cleanCaught;
+            }
+        }
+    });
+    failing.join();
+    clean.join();
+
+    // Each caller sees exactly its own batches' outcome
+    CHECK_EQ(failingCaught, rounds);
+    CHECK_EQ(cleanCaught, 0);
+    CHECK_EQ(cleanTasks, 2 * rounds);
+}
+
+// Run under ThreadSanitizer with `make test-tsan`
+TEST_CASE("Parallel Traversal with Write Buffering") {
+    MagicalContainer container;
+    container.setWriteBuffering(true);
+    for (int value = 1000; value >= 1; --value) {
+        container.addElement(value);
+    }
+
+    // The workers only read; the buffered inserts are merged before any of them starts
+    ThreadPool pool(4);
+    std::atomic<long long> sum{0};
+    parallelForEach(MagicalContainer::AscendingIterator(container), [&sum](int value) { sum += value; }, pool, 8);
+    CHECK_EQ(sum, 500500);
+
+    container.addElement(1009);
+    std::atomic<int> primes{0};
+    parallelForEach(MagicalContainer::PrimeIterator(container), [&primes](int) { ++primes; }, pool, 8);
+    CHECK_EQ(primes, 169);
+
+    // A snapshot is published already merged, so readers sharing it never write to it
+    SnapshotMagicalContainer<int> snapshots;
+    snapshots.update([](MagicalContainer &next) {
+        next.setWriteBuffering(true);
+        for (int value = 1; value <= 1000; ++value) {
+            next.addElement(value);
+        }
+    });
+    auto pinned = snapshots.snapshot();
+    std::vector<long long> sums(4, 0);
+    std::vector<std::thread> readers;
+    for (std::size_t reader = 0; reader < sums.size(); ++reader) {
+        readers.emplace_back([&pinned, &sums, reader] {
+            MagicalContainer::SideCrossIterator cross(*pinned);
+            for (int value: cross) {
+                sums[reader] += value;
+            }
+        });
+    }
+    for (std::thread &reader: readers) {
+        reader.join();
+    }
+    CHECK_EQ(sums, std::vector<long long>(4, 500500));
+}
+
+// Run under ThreadSanitizer with `make test-tsan`
+TEST_CASE("Concurrent Container Stress") {
+    ConcurrentMagicalContainer<int> container;
+    std::vector<int> batch;
+    for (int i = 0; i < 1000; ++i) {
+        batch.push_back(i * 2);
+    }
+    container.addElements(batch.begin(), batch.end());
+
+    std::atomic<int> unsortedReads{0};
+    std::vector<std::thread> threads;
+    for (int writer = 0; writer < 2; ++writer) {
+        threads.emplace_back([&container, writer] {
+            for (int round = 0; round < 200; ++round) {
+                int value = -1 - writer - 2 * round;
+                container.addElement(value);
+                container.removeElement(value);
+            }
+        });
+    }
+    for (int reader = 0; reader < 4; ++reader) {
+        // A fixed number of reads each: readers polling until the writers finish could starve them, since
+        // the shared lock may keep admitting readers ahead of a waiting writer
+        threads.emplace_back([&container, &unsortedReads] {
+            for (int round = 0; round < 200; ++round) {
+                bool sorted = container.read([](const MagicalContainer &snapshot) {
+                    MagicalContainer::AscendingIterator iter(snapshot);
+                    MagicalContainer::PrimeIterator primes(snapshot);
+                    return std::is_sorted(iter.begin(), iter.end()) &&
+                           std::all_of(primes.begin(), primes.end(), MagicalContainer::isPrime);
+                });
+                unsortedReads += sorted ? 0 : 1;
+            }
+        });
+    }
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    CHECK_EQ(unsortedReads, 0);
+    CHECK_EQ(container.size(), 1000);
+    MagicalContainer snapshot = container.snapshot();
+    container.addElement(1);
+    CHECK_EQ(snapshot.size(), 1000);
+    CHECK_EQ(container.size(), 1001);
+}
+
+TEST_CASE("Copy-on-Write Snapshots") {
+    SnapshotMagicalContainer<int> container;
+    std::vector<int> batch{2, 4, 7, 9};
+    container.addElements(batch.begin(), batch.end());
+
+    auto pinned = container.snapshot();
+    MagicalContainer::AscendingIterator iter(*pinned);
+    auto it = iter.begin();
+    container.removeElement(2);
+    container.update([](MagicalContainer &next) {
+        next.addElement(3);
+        next.addElement(11);
+    });
+
+    // The pinned snapshot and its iterator are untouched by later writes
+    CHECK_EQ(*it, 2);
+    CHECK_EQ(std::vector<int>(iter.begin(), iter.end()), batch);
+    CHECK_EQ(pinned->size(), 4);
+
+    std::vector<int> expected{3, 4, 7, 9, 11};
+    CHECK_EQ(container.read([](const MagicalContainer &current) {
+        MagicalContainer::AscendingIterator latest(current);
+        return std::vector<int>(latest.begin(), latest.end());
+    }), expected);
+    CHECK_EQ(container.read([](const MagicalContainer &current) {
+        MagicalContainer::PrimeIterator primes(current);
+        return std::ranges::distance(primes);
+    }), 3);
+
+    std::atomic<bool> writerDone{false};
+    std::atomic<int> badReads{0};
+    std::thread writer([&container, &writerDone] {
+        for (int value = -1; value > -200; --value) {
+            container.addElement(value);
+            container.removeElement(value);
+        }
+        writerDone = true;
+    });
+    std::thread reader([&container, &writerDone, &badReads] {
+        while (!writerDone) {
+            auto snapshot = container.snapshot();
+            MagicalContainer::SideCrossIterator cross(*snapshot);
+            bool consistent = snapshot->size() == 5 || snapshot->size() == 6;
+            badReads += consistent && cross.end() - cross.begin() == snapshot->size() ? 0 : 1;
+        }
+    });
+    writer.join();
+    reader.join();
+    CHECK_EQ(badReads, 0);
+    CHECK_EQ(container.size(), 5);
+}
+
+TEST_CASE("Write Buffering") {
+    MagicalContainer container;
+    container.setWriteBuffering(true);
+    CHECK(container.writeBuffering());
+    for (int value: {9, 4, 7, 2, 11, 6}) {
+        container.addElement(value);
+    }
+    CHECK_EQ(container.size(), 6);
+
+    MagicalContainer::AscendingIterator ascIter(container);
+    auto it = ascIter.begin();
+    CHECK_EQ(*it, 2);
+    ++it;
+    // Buffered inserts show up in their turn for iterators that are already live
+    container.addElement(5);
+    container.addElement(10);
+    CHECK_EQ(*it, 4);
+    CHECK_EQ(*++it, 5);
+    CHECK_EQ(ascIter.end() - ascIter.begin(), 8);
+
+    container.addElement(13);
+    MagicalContainer::PrimeIterator primeIter(container);
+    std::vector<int> primes(primeIter.begin(), primeIter.end());
+    std::vector<int> expectedPrimes{2, 5, 7, 11, 13};
+    CHECK_EQ(primes, expectedPrimes);
+
+    container.addElement(3);
+    container.removeElement(3);
+    container.addElement(8);
+    MagicalContainer::SideCrossIterator crossIter(container);
+    std::vector<int> cross(crossIter.begin(), crossIter.end());
+    std::vector<int> expectedCross{2, 13, 4, 11, 5, 10, 6, 9, 7, 8};
+    CHECK_EQ(cross, expectedCross);
+
+    container.addElement(1);
+    container.setWriteBuffering(false);
+    CHECK_EQ(container.size(), 11);
+    container.addElement(0);
+    CHECK_EQ(*ascIter.begin(), 0);
+}
+
+TEST_CASE("Sorted Blocks Storage") {
+    // Enough values to split into many blocks, checked step by step against the flat vector backend
+    SortedBlocks<int> blocks;
+    SortedVector<int> flat;
+    std::vector<int> batch;
+    for (int i = 0; i < 20000; ++i) {
+        int value = (i * 7919) % 5003;
+        blocks.insert(value);
+        flat.insert(value);
+        if (i % 3 == 0) {
+            batch.push_back(value + 1);
+        }
+    }
+    std::sort(batch.begin(), batch.end());
+    blocks.merge(batch);
+    flat.merge(batch);
+    for (int value = 0; value < 5003; value += 17) {
+        blocks.erase(value);
+        flat.erase(value);
+    }
+    std::vector<int> victims{1, 2, 3, 500, 4000, 4001};
+    blocks.remove(victims);
+    flat.remove(victims);
+
+    REQUIRE_EQ(blocks.size(), flat.size());
+    bool same = true;
+    for (std::size_t i = 0; i < flat.size(); ++i) {
+        same = same && blocks[i] == flat[i];
+    }
+    CHECK(same);
+    CHECK_EQ(blocks[flat.size() / 2], flat[flat.size() / 2]);
+    CHECK_EQ(blocks.front(), flat.front());
+    CHECK_EQ(blocks.back(), flat.back());
+
+    SortedBlocks<int> moved = std::move(blocks);
+    CHECK_EQ(moved.size(), flat.size());
+    CHECK(blocks.empty());
+    CHECK_EQ(blocks.size(), 0);
+}
+
+TEST_CASE("Sorted Blocks Compaction") {
+    // 16 KiB blocks hold 4096 ints, so 100000 values fill 25 of them
+    std::vector<int> values(100000);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<int>(i);
+    }
+    SortedBlocks<int> erased;
+    erased.merge(values);
+    REQUIRE_EQ(erased.blockCount(), 25);
+
+    // Keeping every 20th value leaves about 200 per block unless underfull blocks are folded together
+    std::vector<int> victims;
+    for (int value: values) {
+        if (value % 20 != 0) {
+            erased.erase(value);
+            victims.push_back(value);
+        }
+    }
+    REQUIRE_EQ(erased.size(), 5000);
+    CHECK_LE(erased.blockCount(), 5);
+
+    SortedBlocks<int> removed;
+    removed.merge(values);
+    removed.remove(victims);
+    REQUIRE_EQ(removed.size(), 5000);
+    CHECK_LE(removed.blockCount(), 5);
+
+    bool same = true;
+    for (std::size_t i = 0; i < 5000; ++i) {
+        same = same && erased[i] == static_cast<int>(20 * i) && removed[i] == static_cast<int>(20 * i);
+    }
+    CHECK(same);
+    CHECK_EQ(erased.lowerBound(99980), 4999);
+    CHECK_EQ(removed.upperBound(40), 3);
+}
+
+TEST_CASE("Iterators Re-anchor After Mutation") {
+    MagicalContainer container;
+    std::vector<int> batch{10, 20, 30, 40, 50};
+    container.addElements(batch.begin(), batch.end());
+
+    MagicalContainer::AscendingIterator ascIter(container);
+    auto it = ascIter.begin() + 2;
+    CHECK_EQ(*it, 30);
+    // An insert before the cursor must not make it repeat 30
+    container.addElement(5);
+    ++it;
+    CHECK_EQ(*it, 40);
+    // A removal before the cursor must not make it skip 50
+    container.removeElement(10);
+    container.removeElement(20);
+    ++it;
+    CHECK_EQ(*it, 50);
+    // Removing the element under the cursor moves it onto the next one
+    container.addElement(60);
+    container.removeElement(50);
+    CHECK_EQ(*it, 60);
+    ++it;
+    CHECK_EQ(it, ascIter.end());
+
+    std::vector<int> visited;
+    for (auto cursor = ascIter.begin(); cursor != ascIter.end(); ++cursor) {
+        visited.push_back(*cursor);
+        if (*cursor == 30) {
+            container.addElement(1);
+            container.addElement(45);
+        }
+    }
+    // 1 lands behind the cursor and is not visited; 45 is visited in its turn
+    std::vector<int> expected{5, 30, 40, 45, 60};
+    CHECK_EQ(visited, expected);
+
+    MagicalContainer::PrimeIterator primeIter(container);
+    container.addElement(7);
+    container.addElement(11);
+    auto prime = primeIter.begin() + 1;
+    CHECK_EQ(*prime, 7);
+    container.addElement(2);
+    container.addElement(3);
+    ++prime;
+    CHECK_EQ(*prime, 11);
+    container.removeElement(7);
+    ++prime;
+    CHECK_EQ(prime, primeIter.end());
+}
+
+TEST_CASE("Collect Primes") {
+    MagicalContainer container;
+    std::vector<int> batch{15, 2, 9, 13, 4, 7, 2, -3, 1};
+    container.addElements(batch.begin(), batch.end());
+    container.setWriteBuffering(true);
+    container.addElement(11);
+
+    std::vector<int> primes{0};
+    container.collectPrimes(primes);
+    std::vector<int> expected{0, 2, 2, 7, 11, 13};
+    CHECK_EQ(primes, expected);
+
+    MagicalContainer::PrimeIterator primeIter(container);
+    CHECK_EQ(std::vector<int>(primeIter.begin(), primeIter.end()), std::vector<int>(primes.begin() + 1, primes.end()));
+}
+
+TEST_CASE("Lookups") {
+    MagicalContainer container;
+    std::vector<int> batch;
+    for (int i = 0; i < 1000; ++i) {
+        batch.push_back(i * 3);
+    }
+    batch.push_back(300);
+    container.addElements(batch.begin(), batch.end());
+
+    for (int round = 0; round < 2; ++round) {
+        CHECK(container.contains(0));
+        CHECK(container.contains(2997));
+        CHECK_FALSE(container.contains(1));
+        CHECK_FALSE(container.contains(-3));
+        CHECK_FALSE(container.contains(3000));
+        CHECK_EQ(container.lowerBound(-5), 0);
+        CHECK_EQ(container.lowerBound(4), 2);
+        CHECK_EQ(container.lowerBound(300), 100);
+        CHECK_EQ(container.lowerBound(301), 102);
+        CHECK_EQ(container.lowerBound(5000), 1001);
+        CHECK_EQ(container.countInRange(300, 300), 2);
+        CHECK_EQ(container.countInRange(1, 9), 3);
+        CHECK_EQ(container.countInRange(-100, 100000), 1001);
+        CHECK_EQ(container.countInRange(9, 1), 0);
+
+        MagicalContainer::AscendingIterator ascIter(container);
+        CHECK_EQ(*(ascIter.begin() + container.lowerBound(500)), 501);
+        // The second round answers the same queries through the Eytzinger index
+        container.buildSearchIndex();
+    }
+
+    // A mutation retires the index until it is rebuilt
+    container.addElement(1);
+    CHECK(container.contains(1));
+    CHECK_EQ(container.lowerBound(4), 3);
+}
+
+TEST_CASE("Save and Open") {
+    std::string path = "magical_container_test.bin";
+    MagicalContainer original;
+    std::vector<int> batch{15, 2, 9, 13, 4, 7, 2, -3, 1, 100, 97};
+    original.addElements(batch.begin(), batch.end());
+    original.save(path);
+
+    MagicalContainer opened = MagicalContainer::open(path);
+    CHECK_EQ(opened.size(), original.size());
+    MagicalContainer::AscendingIterator ascOriginal(original), ascOpened(opened);
+    CHECK_EQ(std::vector<int>(ascOpened.begin(), ascOpened.end()),
+             std::vector<int>(ascOriginal.begin(), ascOriginal.end()));
+    MagicalContainer::SideCrossIterator crossOriginal(original), crossOpened(opened);
+    CHECK_EQ(std::vector<int>(crossOpened.begin(), crossOpened.end()),
+             std::vector<int>(crossOriginal.begin(), crossOriginal.end()));
+    MagicalContainer::PrimeIterator primeOpened(opened);
+    CHECK_EQ(std::vector<int>(primeOpened.begin(), primeOpened.end()), std::vector<int>{2, 2, 7, 13, 97});
+
+    // Mutating an opened container works on a private copy and leaves the file alone
+    opened.addElement(5);
+    opened.removeElement(100);
+    CHECK_EQ(std::vector<int>(primeOpened.begin(), primeOpened.end()), std::vector<int>{2, 2, 5, 7, 13, 97});
+    MagicalContainer reopened = MagicalContainer::open(path);
+    CHECK_EQ(reopened.size(), original.size());
+    CHECK(reopened.contains(100));
+
+    CHECK_THROWS_AS((void) BasicMagicalContainer<std::int64_t>::open(path), std::runtime_error);
+    CHECK_THROWS_AS((void) MagicalContainer::open(path + ".missing"), std::runtime_error);
+
+    // Flip one payload byte: the checksum catches it unless verification is skipped
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-1, std::ios::end);
+        file.put('\x7f');
+    }
+    CHECK_THROWS_AS((void) MagicalContainer::open(path), std::runtime_error);
+    CHECK_EQ(MagicalContainer::open(path, false).size(), original.size());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Streaming Loader") {
+    std::string path = "magical_loader_test.txt";
+    auto writeFile = [&path](const std::string &contents) {
+        std::ofstream(path, std::ios::binary) << contents;
+    };
+
+    writeFile("15,2\r\n9 13\n\n-3\t4, 7\n2147483647\n-2147483648\n0000000000017");
+    MagicalContainer container;
+    CHECK_EQ(loadFromFile(container, path, LoadFormat::Text), 10);
+    MagicalContainer::AscendingIterator ascIter(container);
+    std::vector<int> expected{-2147483648, -3, 2, 4, 7, 9, 13, 15, 17, 2147483647};
+    CHECK_EQ(std::vector<int>(ascIter.begin(), ascIter.end()), expected);
+    MagicalContainer::PrimeIterator primeIter(container);
+    CHECK_EQ(std::vector<int>(primeIter.begin(), primeIter.end()), std::vector<int>{2, 7, 13, 17, 2147483647});
+
+    // Enough values to span several read chunks and several merged batches
+    std::string text;
+    std::vector<std::int64_t> values;
+    for (std::int64_t i = 0; i < 300000; ++i) {
+        values.push_back((i * 7919) % 1000003 - 500000);
+        text += std::to_string(values.back()) + (i % 2 == 0 ? "\n" : ",");
+    }
+    writeFile(text);
+    BasicMagicalContainer<std::int64_t> wide;
+    CHECK_EQ(loadFromFile(wide, path, LoadFormat::Text), values.size());
+    std::sort(values.begin(), values.end());
+    BasicMagicalContainer<std::int64_t>::AscendingIterator wideIter(wide);
+    CHECK_EQ(std::vector<std::int64_t>(wideIter.begin(), wideIter.end()), values);
+
+    std::string binary(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(std::int64_t));
+    writeFile(binary);
+    BasicMagicalContainer<std::int64_t> fromBinary;
+    CHECK_EQ(loadFromFile(fromBinary, path, LoadFormat::Binary), values.size());
+    CHECK_EQ(fromBinary.size(), wide.size());
+    CHECK_EQ(fromBinary.countInRange(-500000, 0), wide.countInRange(-500000, 0));
+
+    // Values parsed before an error stay in the container; the bad token and anything after it do not
+    writeFile(binary.substr(0, 12));
+    BasicMagicalContainer<std::int64_t> truncated;
+    CHECK_THROWS_AS(loadFromFile(truncated, path, LoadFormat::Binary), std::runtime_error);
+    CHECK_EQ(truncated.size(), 1);
+    CHECK(truncated.contains(values.front()));
+    writeFile("1\n2x\n");
+    MagicalContainer badCharacter;
+    CHECK_THROWS_AS(loadFromFile(badCharacter, path, LoadFormat::Text), std::runtime_error);
+    CHECK_EQ(badCharacter.size(), 1);
+    CHECK(badCharacter.contains(1));
+    writeFile("1\n-\n");
+    MagicalContainer loneSign;
+    CHECK_THROWS_AS(loadFromFile(loneSign, path, LoadFormat::Text), std::runtime_error);
+    CHECK_EQ(loneSign.size(), 1);
+    CHECK(loneSign.contains(1));
+    writeFile("5\n2147483648\n7\n");
+    MagicalContainer outOfRange;
+    CHECK_THROWS_AS(loadFromFile(outOfRange, path, LoadFormat::Text), std::runtime_error);
+    CHECK_EQ(outOfRange.size(), 1);
+    CHECK(outOfRange.contains(5));
+    writeFile("-1\n");
+    BasicMagicalContainer<std::uint64_t> unsignedContainer;
+    CHECK_THROWS_AS(loadFromFile(unsignedContainer, path, LoadFormat::Text), std::runtime_error);
+    CHECK_EQ(unsignedContainer.size(), 0);
+    CHECK_THROWS_AS(loadFromFile(container, path + ".missing", LoadFormat::Text), std::runtime_error);
+    CHECK_EQ(container.size(), 10);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Bulk Export") {
+    MagicalContainer container;
+    std::vector<int> batch{15, 2, 9, 13, 4, 7, 2, -3, 1, 100, 97};
+    container.addElements(batch.begin(), batch.end());
+    MagicalContainer::AscendingIterator ascIter(container);
+    MagicalContainer::SideCrossIterator crossIter(container);
+    MagicalContainer::PrimeIterator primeIter(container);
+    std::vector<int> ascending(ascIter.begin(), ascIter.end());
+    std::vector<int> cross(crossIter.begin(), crossIter.end());
+    std::vector<int> primes(primeIter.begin(), primeIter.end());
+
+    std::vector<int> out(20, 0);
+    CHECK_EQ(container.exportTo(out, MagicalOrder::Ascending), ascending.size());
+    CHECK_EQ(std::vector<int>(out.begin(), out.begin() + 11), ascending);
+    CHECK_EQ(container.exportTo(out, MagicalOrder::SideCross), cross.size());
+    CHECK_EQ(std::vector<int>(out.begin(), out.begin() + 11), cross);
+    CHECK_EQ(container.exportTo(out, MagicalOrder::Prime), primes.size());
+    CHECK_EQ(std::vector<int>(out.begin(), out.begin() + 5), primes);
+
+    // Resuming from every offset, including odd ones in the cross order, with a span shorter than the rest
+    for (std::size_t from = 0; from <= cross.size(); ++from) {
+        std::vector<int> window(4, 0);
+        auto count = container.exportTo(window, MagicalOrder::SideCross, from);
+        CHECK_EQ(count, std::min<std::size_t>(4, cross.size() - from));
+        CHECK(std::equal(window.begin(), window.begin() + static_cast<std::ptrdiff_t>(count),
+                         cross.begin() + static_cast<std::ptrdiff_t>(from)));
+    }
+    CHECK_THROWS_AS(container.forEachRun(MagicalOrder::SideCross, [](const int *, std::size_t) {}),
+                    std::invalid_argument);
+
+    std::string path = "magical_export_test.dat";
+    for (LoadFormat format: {LoadFormat::Text, LoadFormat::Binary}) {
+        CHECK_EQ(exportToFile(container, path, MagicalOrder::SideCross, format), cross.size());
+        std::ifstream in(path, std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (format == LoadFormat::Binary) {
+            CHECK_EQ(contents, std::string(reinterpret_cast<const char *>(cross.data()), cross.size() * sizeof(int)));
+        } else {
+            CHECK_EQ(contents.substr(0, 7), "-3\n100\n");
+        }
+        MagicalContainer reloaded;
+        CHECK_EQ(exportToFile(container, path, MagicalOrder::Prime, format), primes.size());
+        loadFromFile(reloaded, path, format);
+        MagicalContainer::AscendingIterator reloadedIter(reloaded);
+        CHECK_EQ(std::vector<int>(reloadedIter.begin(), reloadedIter.end()), primes);
+    }
+    std::remove(path.c_str());
+}
+
+// Forwards to the default resource and counts what passes through
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::size_t allocations = 0;
+    std::size_t liveBytes = 0;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++allocations;
+        liveBytes += bytes;
+        return std::pmr::get_default_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override {
+        liveBytes -= bytes;
+        std::pmr::get_default_resource()->deallocate(pointer, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST_CASE("Memory Resources") {
+    CountingResource counting;
+    {
+        PmrMagicalContainer container(&counting);
+        CHECK_EQ(container.get_allocator().resource(), &counting);
+        std::vector<int> batch;
+        for (int i = 0; i < 5000; ++i) {
+            batch.push_back((i * 7919) % 10007);
+        }
+        container.addElements(batch.begin(), batch.end());
+        container.addElement(2);
+        container.removeElement(9);
+        container.buildSearchIndex();
+        CHECK(container.contains(2));
+        CHECK(counting.allocations > 0);
+        CHECK(counting.liveBytes >= 5000 * sizeof(int));
+
+        MagicalContainer reference;
+        reference.addElements(batch.begin(), batch.end());
+        reference.addElement(2);
+        reference.removeElement(9);
+        PmrMagicalContainer::AscendingIterator ascIter(container);
+        MagicalContainer::AscendingIterator referenceIter(reference);
+        CHECK(std::equal(ascIter.begin(), ascIter.end(), referenceIter.begin(), referenceIter.end()));
+        PmrMagicalContainer::PrimeIterator primeIter(container);
+        MagicalContainer::PrimeIterator referencePrimes(reference);
+        CHECK(std::equal(primeIter.begin(), primeIter.end(), referencePrimes.begin(), referencePrimes.end()));
+    }
+    CHECK_EQ(counting.liveBytes, 0);
+
+    // An arena with no upstream: anything that escapes it would throw bad_alloc
+    std::vector<std::byte> arena(1U << 20U);
+    std::pmr::monotonic_buffer_resource monotonic(arena.data(), arena.size(), std::pmr::null_memory_resource());
+    PmrBasicMagicalContainer<std::int64_t> arenaContainer(&monotonic);
+    for (std::int64_t value = 0; value < 1000; ++value) {
+        arenaContainer.addElement(value * 3);
+    }
+    CHECK_EQ(arenaContainer.size(), 1000);
+    CHECK_EQ(arenaContainer.countInRange(0, 29), 10);
+}
+
+TEST_CASE("Inline Storage") {
+    // Same operations on an inline-capable vector and a plain one, across the spill to the heap
+    SortedVector<int, std::allocator<int>, 4> small;
+    SortedVector<int> plain;
+    auto same = [&small, &plain]() {
+        std::vector<int> smallValues, plainValues;
+        small.appendTo(smallValues);
+        plain.appendTo(plainValues);
+        return smallValues == plainValues;
+    };
+    for (int value: {5, 1, 5, 3}) {
+        CHECK_EQ(small.insert(value), plain.insert(value));
+    }
+    CHECK(same());
+    small.erase(5);
+    plain.erase(5);
+    std::vector<int> batch{0, 4};
+    small.merge(batch);
+    plain.merge(batch);
+    CHECK(same());
+
+    SortedVector<int, std::allocator<int>, 4> copy(small);
+    SortedVector<int, std::allocator<int>, 4> moved(std::move(copy));
+    CHECK_EQ(moved.size(), 4);
+    CHECK(copy.empty());
+    moved.insert(2);
+    CHECK_EQ(moved.size(), 5);
+    CHECK_EQ(small.size(), 4);
+
+    small.insert(2);
+    plain.insert(2);
+    std::vector<int> victims{1, 4};
+    small.remove(victims);
+    plain.remove(victims);
+    CHECK(same());
+    CHECK_EQ(small.lowerBound(3), plain.lowerBound(3));
+
+    SortedVector<int, std::allocator<int>, 4> movedHeap(std::move(moved));
+    CHECK_EQ(movedHeap.size(), 5);
+    CHECK_EQ(movedHeap[4], 4);
+    CHECK_EQ(moved.insert(7), 0);
+    CHECK_EQ(moved.front(), 7);
+
+    // A Demo-sized container, copied and moved while its elements are inline
+    MagicalContainer container;
+    for (int value: {17, 2, 25, 9, 3}) {
+        container.addElement(value);
+    }
+    MagicalContainer copied(container);
+    MagicalContainer taken(std::move(copied));
+    container.removeElement(9);
+    MagicalContainer::AscendingIterator ascIter(taken);
+    CHECK_EQ(std::vector<int>(ascIter.begin(), ascIter.end()), std::vector<int>{2, 3, 9, 17, 25});
+    MagicalContainer::SideCrossIterator crossIter(container);
+    CHECK_EQ(std::vector<int>(crossIter.begin(), crossIter.end()), std::vector<int>{2, 25, 3, 17});
+    MagicalContainer::PrimeIterator primeIter(taken);
+    CHECK_EQ(std::vector<int>(primeIter.begin(), primeIter.end()), std::vector<int>{2, 3, 17});
+}
+
+TEST_CASE("Packed Storage") {
+    // Same workload as the blocks test, checked step by step against the flat vector backend
+    SortedPacked<int> packed;
+    SortedVector<int> flat;
+    std::vector<int> batch;
+    for (int i = 0; i < 20000; ++i) {
+        int value = (i * 7919) % 5003 - 2500;
+        packed.insert(value);
+        flat.insert(value);
+        if (i % 3 == 0) {
+            batch.push_back(value + 1);
+        }
+    }
+    std::sort(batch.begin(), batch.end());
+    packed.merge(batch);
+    flat.merge(batch);
+    for (int value = -2500; value < 2503; value += 17) {
+        packed.erase(value);
+        flat.erase(value);
+    }
+    std::vector<int> victims{-2499, 1, 2, 3, 500, 2000, 2001};
+    packed.remove(victims);
+    flat.remove(victims);
+
+    REQUIRE_EQ(packed.size(), flat.size());
+    bool same = true;
+    for (std::size_t i = 0; i < flat.size(); ++i) {
+        same = same && packed[i] == flat[i];
+    }
+    CHECK(same);
+    // Reads alternating between the two ends, as the cross order does
+    same = true;
+    for (std::size_t i = 0; i < flat.size() / 2; ++i) {
+        same = same && packed[i] == flat[i] && packed[flat.size() - 1 - i] == flat[flat.size() - 1 - i];
+    }
+    CHECK(same);
+    CHECK_EQ(packed.front(), flat.front());
+    CHECK_EQ(packed.back(), flat.back());
+    for (int value: {-3000, -2500, -7, 0, 1, 2498, 3000}) {
+        CHECK_EQ(packed.lowerBound(value), flat.lowerBound(value));
+        CHECK_EQ(packed.upperBound(value), flat.upperBound(value));
+    }
+    std::vector<int> runs;
+    packed.forEachRun([&runs](const int *run, std::size_t length) { runs.insert(runs.end(), run, run + length); });
+    std::vector<int> expected;
+    flat.appendTo(expected);
+    CHECK_EQ(runs, expected);
+
+    // A block read before a change must not be served from the cache after it
+    int before = packed[10];
+    packed.erase(before);
+    flat.erase(before);
+    CHECK_NE(packed[10], before);
+    SortedPacked<int> copy(packed);
+    copy.insert(-10000);
+    CHECK_EQ(copy[0], -10000);
+    CHECK_EQ(packed[0], flat[0]);
+
+    SortedPacked<int> moved = std::move(packed);
+    CHECK_EQ(moved.size(), flat.size());
+    CHECK(packed.empty());
+
+    // Runs of one value pack to no bits at all, and gaps spanning the whole type to 64
+    SortedPacked<std::uint64_t> wide;
+    std::vector<std::uint64_t> extremes(300, 5);
+    extremes.push_back(std::numeric_limits<std::uint64_t>::max() - 1);
+    extremes.push_back(std::numeric_limits<std::uint64_t>::max());
+    extremes.insert(extremes.begin(), 0);
+    wide.merge(extremes);
+    std::vector<std::uint64_t> unpacked;
+    wide.appendTo(unpacked);
+    CHECK_EQ(unpacked, extremes);
+    CHECK_EQ(wide.upperBound(5), 301);
+    wide.erase(5);
+    CHECK_EQ(wide.size(), 3);
+    CHECK_EQ(wide[1], std::numeric_limits<std::uint64_t>::max() - 1);
+}
+
+// Concatenates the runs storage hands out for [from, from + length), counting how many it visited
+template<typename Storage>
+static std::vector<int> rangedRuns(const Storage &storage, std::size_t from, std::size_t length, int &visits) {
+    std::vector<int> joined;
+    visits = 0;
+    storage.forEachRun(from, length, [&joined, &visits](const int *run, std::size_t count) {
+        joined.insert(joined.end(), run, run + count);
+        ++visits;
+    });
+    return joined;
+}
+
+TEST_CASE("Ranged Runs") {
+    std::vector<int> values;
+    for (int i = 0; i < 30000; ++i) {
+        values.push_back(3 * i + (i % 7));
+    }
+    SortedVector<int> flat;
+    SortedBlocks<int> blocks;
+    SortedPacked<int> packed;
+    flat.merge(values);
+    blocks.merge(values);
+    packed.merge(values);
+
+    bool same = true;
+    for (std::size_t from: {std::size_t{0}, std::size_t{1}, std::size_t{127}, std::size_t{128}, std::size_t{4095},
+                            std::size_t{12345}, std::size_t{29990}, std::size_t{30000}, std::size_t{40000}}) {
+        for (std::size_t length: {std::size_t{0}, std::size_t{1}, std::size_t{200}, std::size_t{9000}, values.size()}) {
+            auto first = values.begin() + static_cast<std::ptrdiff_t>(std::min(from, values.size()));
+            auto last = values.begin() + static_cast<std::ptrdiff_t>(std::min(from + length, values.size()));
+            std::vector<int> expected(first, last);
+            int visits = 0;
+            same = same && rangedRuns(flat, from, length, visits) == expected;
+            same = same && rangedRuns(blocks, from, length, visits) == expected;
+            same = same && rangedRuns(packed, from, length, visits) == expected;
+        }
+    }
+    CHECK(same);
+
+    // Only the blocks overlapping the window are decoded, however far into the run it starts
+    int visits = 0;
+    CHECK_EQ(rangedRuns(packed, 20000, 10, visits).size(), 10);
+    CHECK_LE(visits, 2);
+    CHECK_EQ(rangedRuns(blocks, 20000, 10, visits).size(), 10);
+    CHECK_LE(visits, 2);
+}
@@ -0,0 +1,48 @@
+#include "ConcurrentMagicalContainer.hpp"
+
+template<typename T, typename Mutex>
+void ConcurrentMagicalContainer<T, Mutex>::addElement(T element) {
+    WriteLock guard(lock);
+    container.addElement(element);
+}
+
+template<typename T, typename Mutex>
+void ConcurrentMagicalContainer<T, Mutex>::addElements(std::vector<T> batch) {
+    WriteLock guard(lock);
+    container.addElements(std::move(batch));
+}
+
+template<typename T, typename Mutex>
+void ConcurrentMagicalContainer<T, Mutex>::removeElement(T element) {
+    WriteLock guard(lock);
+    container.removeElement(element);
+}
+
+template<typename T, typename Mutex>
+void ConcurrentMagicalContainer<T, Mutex>::removeElements(std::vector<T> victims) {
+    WriteLock guard(lock);
+    container.removeElements(std::move(victims));
+}
+
+template<typename T, typename Mutex>
+int ConcurrentMagicalContainer<T, Mutex>::size() const {
+    ReadLock guard(lock);
+    return container.size();
+}
+
+template<typename T, typename Mutex>
+MagicalContainerStats ConcurrentMagicalContainer<T, Mutex>::stats() const {
+    ReadLock guard(lock);
+    return container.stats();
+}
+
+template<typename T, typename Mutex>
+BasicMagicalContainer<T> ConcurrentMagicalContainer<T, Mutex>::snapshot() const {
+    ReadLock guard(lock);
+    return container;
+}
+
+template class ConcurrentMagicalContainer<std::int32_t>;
+template class ConcurrentMagicalContainer<std::int64_t>;
+template class ConcurrentMagicalContainer<std::uint64_t>;
+template class ConcurrentMagicalContainer<std::int32_t, std::mutex>;
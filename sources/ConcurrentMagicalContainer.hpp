@@ -0,0 +1,66 @@
+#ifndef CONCURRENTMAGICALCONTAINER_H
+#define CONCURRENTMAGICALCONTAINER_H
+
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "MagicalContainer.hpp"
+
+// BasicMagicalContainer behind a reader-writer lock. Mutations take the lock exclusively; read() runs a
+// callable on the container under a shared lock, so any number of readers iterate side by side while
+// writers wait for them. Iterators must not outlive the read() call that created them; take a snapshot()
+// to keep iterating after the lock is released. Mutex = std::mutex gives the single global lock baseline.
+template<typename T, typename Mutex = std::shared_mutex>
+class ConcurrentMagicalContainer {
+private:
+    using ReadLock = std::conditional_t<std::is_same_v<Mutex, std::shared_mutex>, std::shared_lock<Mutex>,
+                                        std::unique_lock<Mutex>>;
+    using WriteLock = std::unique_lock<Mutex>;
+
+    BasicMagicalContainer<T> container;
+    mutable Mutex lock;
+
+public:
+    using value_type = T;
+
+    void addElement(T element);
+
+    void addElements(std::vector<T> batch);
+
+    template<typename InputIt>
+    void addElements(InputIt first, InputIt last) {
+        addElements(std::vector<T>(first, last));
+    }
+
+    void removeElement(T element);
+
+    void removeElements(std::vector<T> victims);
+
+    template<typename InputIt>
+    void removeElements(InputIt first, InputIt last) {
+        removeElements(std::vector<T>(first, last));
+    }
+
+    [[nodiscard]] int size() const;
+
+    [[nodiscard]] MagicalContainerStats stats() const;
+
+    // Copy of the current contents that stays valid and unchanged while writers continue
+    [[nodiscard]] BasicMagicalContainer<T> snapshot() const;
+
+    // Calls reader(const BasicMagicalContainer<T> &) under the read lock and returns its result
+    template<typename Reader>
+    auto read(Reader reader) const {
+        ReadLock guard(lock);
+        return reader(std::as_const(container));
+    }
+};
+
+extern template class ConcurrentMagicalContainer<std::int32_t>;
+extern template class ConcurrentMagicalContainer<std::int64_t>;
+extern template class ConcurrentMagicalContainer<std::uint64_t>;
+extern template class ConcurrentMagicalContainer<std::int32_t, std::mutex>;
+
+#endif  // CONCURRENTMAGICALCONTAINER_H
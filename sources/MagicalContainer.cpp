@@ -1,181 +1,818 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <ranges>
 #include <stdexcept>
 #include "MagicalContainer.hpp"
+#include "MappedFile.hpp"
+
+#ifdef MAGICAL_CONTAINER_STATS
+#define MAGICAL_STAT(owner, field, amount) ((owner).counters.field.add(static_cast<std::uint64_t>(amount)))
+#else
+// Still evaluates amount, so values computed only to be counted do not trip -Wunused-but-set-variable
+#define MAGICAL_STAT(owner, field, amount) ((void) (amount))
+#endif
+
+template<typename T, typename Allocator>
+BasicMagicalContainer<T, Allocator>::BasicMagicalContainer(const Allocator &allocator)
+        : elements(allocator), primes(allocator), pending(allocator), searchIndex(allocator) {}
+
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::isPrime(T number) {
+    if constexpr (std::is_signed_v<T>) {
+        if (number < 2) {
+            return false;
+        }
+    }
+    if constexpr (sizeof(T) <= sizeof(std::uint32_t)) {
+        return isPrime32(static_cast<std::uint32_t>(number));
+    } else {
+        return ::isPrime64(static_cast<std::uint64_t>(number));
+    }
+}
+
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::isPrime64(std::uint64_t number) {
+    return ::isPrime64(number);
+}
+
+// Values the int64-based sieve can represent; only the top half of uint64_t falls outside
+template<typename T>
+static bool fitsInt64(T number) {
+    if constexpr (std::is_unsigned_v<T> && sizeof(T) >= sizeof(std::int64_t)) {
+        return number <= static_cast<T>(INT64_MAX);
+    } else {
+        return true;
+    }
+}
+
+// Sieving this many values costs about as much as one Miller-Rabin test
+static const std::int64_t SIEVE_VALUES_PER_TEST = 32;
+static const std::int64_t MAX_SIEVE_SPAN = std::int64_t{1} << 28;
+// Keeps the base-prime sieve (up to sqrt of the top value) around a megabyte
+static const std::int64_t MAX_SIEVE_VALUE = std::int64_t{1} << 42;
+
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::testPrime(T number) const {
+    auto wide = static_cast<std::int64_t>(number);
+    if (fitsInt64(number) && primeOracle.covers(wide, wide)) {
+        MAGICAL_STAT(*this, primalityCached, 1);
+        return primeOracle.isPrime(wide);
+    }
+    MAGICAL_STAT(*this, primalityTests, 1);
+    return isPrime(number);
+}
+
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::addElement(T element) {
+    MAGICAL_STAT(*this, inserts, 1);
+    if (buffering) {
+        pending.push_back(element);
+        return;
+    }
 
-void MagicalContainer::addElement(int element) {
-    elements.push_back(element);
-    std::sort(elements.begin(), elements.end());
+    // elements is always sorted, so find the slot and shift the tail once instead of re-sorting
+    ++generation;
+    auto moves = elements.insert(element);
+    MAGICAL_STAT(*this, elementMoves, moves);
+    if (testPrime(element)) {
+        moves = primes.insert(element);
+        MAGICAL_STAT(*this, elementMoves, moves);
+    }
+}
+
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::addElements(std::vector<T> batch) {
+    MAGICAL_STAT(*this, inserts, batch.size());
+    // A batch on the same allocator can become the buffer itself; any other is copied into the allocator
+    if constexpr (std::is_same_v<Allocator, std::allocator<T>>) {
+        if (pending.empty()) {
+            pending.swap(batch);
+        }
+    }
+    pending.insert(pending.end(), batch.begin(), batch.end());
+    mergePending();
+}
+
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::mergePending() const {
+    std::vector<T, Allocator> batch(pending.get_allocator());
+    batch.swap(pending);
+    ++generation;
+    MAGICAL_STAT(*this, sorts, 1);
+    std::sort(batch.begin(), batch.end());
+
+    auto moves = elements.merge(batch);
+    MAGICAL_STAT(*this, elementMoves, moves);
+
+    // Re-sieve [min, max] of the container when it is dense enough to beat testing the batch value by value
+    if (!batch.empty() && fitsInt64(elements.back())) {
+        auto max = static_cast<std::int64_t>(elements.back());
+        // Primes start at 2, so negative elements never need sieving
+        auto min = std::max<std::int64_t>(static_cast<std::int64_t>(std::max(elements.front(), T{0})), 2);
+        if (max >= min && max <= MAX_SIEVE_VALUE && max - min < MAX_SIEVE_SPAN &&
+            max - min < SIEVE_VALUES_PER_TEST * static_cast<std::int64_t>(batch.size()) &&
+            !primeOracle.covers(min, max)) {
+            primeOracle.cover(min, max);
+        }
+    }
+
+    std::vector<T, Allocator> batchPrimes(pending.get_allocator());
+    std::copy_if(batch.begin(), batch.end(), std::back_inserter(batchPrimes),
+                 [this](T value) { return testPrime(value); });
+    moves = primes.merge(batchPrimes);
+    MAGICAL_STAT(*this, elementMoves, moves);
+}
+
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::removeElement(T element) {
+    MAGICAL_STAT(*this, removes, 1);
+    flush();
+
+    // The prime index is itself sorted, so a lookup there replaces a primality test
+    ++generation;
+    auto moves = elements.erase(element);
+    moves += primes.erase(element);
+    MAGICAL_STAT(*this, elementMoves, moves);
+}
+
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::removeElements(std::vector<T> victims) {
+    MAGICAL_STAT(*this, removes, victims.size());
+    flush();
+    MAGICAL_STAT(*this, sorts, 1);
+    std::sort(victims.begin(), victims.end());
+    ++generation;
+    auto moves = elements.remove(victims);
+    moves += primes.remove(victims);
+    MAGICAL_STAT(*this, elementMoves, moves);
+}
+
+// Index of the first element not below (or with OrEqual, above) value, through the search index when current
+template<typename T, typename Allocator>
+template<bool OrEqual>
+std::size_t BasicMagicalContainer<T, Allocator>::rank(T value) const {
+    flush();
+    if (searchIndexGeneration == generation && searchIndex.size() == elements.size()) {
+        return OrEqual ? searchIndex.upperBound(value) : searchIndex.lowerBound(value);
+    }
+    return OrEqual ? elements.upperBound(value) : elements.lowerBound(value);
+}
+
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::contains(T element) const {
+    flush();
+    if (searchIndexGeneration == generation && searchIndex.size() == elements.size()) {
+        return searchIndex.contains(element);
+    }
+    auto index = elements.lowerBound(element);
+    return index < elements.size() && elements[index] == element;
+}
+
+template<typename T, typename Allocator>
+int BasicMagicalContainer<T, Allocator>::lowerBound(T element) const {
+    return static_cast<int>(rank(element));
+}
+
+template<typename T, typename Allocator>
+int BasicMagicalContainer<T, Allocator>::countInRange(T low, T high) const {
+    if (high < low) {
+        return 0;
+    }
+    return static_cast<int>(rank<true>(high) - rank(low));
 }
 
-void MagicalContainer::removeElement(int element) {
-    elements.erase(std::remove(elements.begin(), elements.end(), element), elements.end());
-    std::sort(elements.begin(), elements.end());
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::buildSearchIndex() {
+    flush();
+    searchIndex.build(elements);
+    searchIndexGeneration = generation;
 }
 
-int MagicalContainer::size() const {
-    return elements.size();
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::collectPrimes(std::vector<T> &out) const {
+    flush();
+    primes.appendTo(out);
+}
+
+template<typename T, typename Allocator>
+std::size_t BasicMagicalContainer<T, Allocator>::exportTo(std::span<T> out, MagicalOrder order, std::size_t from) const {
+    flush();
+    const MagicalStorage<T, Allocator> &source = order == MagicalOrder::Prime ? primes : elements;
+    std::size_t total = source.size();
+    if (from >= total) {
+        return 0;
+    }
+    std::size_t count = std::min(out.size(), total - from);
+    if (order != MagicalOrder::SideCross) {
+        // Only the runs overlapping the window are visited, so a chunked export stays linear overall
+        T *write = out.data();
+        source.forEachRun(from, count, [&write](const T *run, std::size_t length) {
+            write = std::copy_n(run, length, write);
+        });
+        return count;
+    }
+    // Even offsets k walk the front half upwards from k / 2, odd ones the back half downwards from n - 1 - k / 2
+    std::size_t firstEven = from + from % 2;
+    for (std::size_t k = firstEven, index = firstEven / 2; k < from + count; k += 2, ++index) {
+        out[k - from] = source[index];
+    }
+    std::size_t firstOdd = from + 1 - from % 2;
+    for (std::size_t k = firstOdd, index = total - 1 - firstOdd / 2; k < from + count; k += 2, --index) {
+        out[k - from] = source[index];
+    }
+    return count;
+}
+
+template<typename T, typename Allocator>
+int BasicMagicalContainer<T, Allocator>::size() const {
+    return static_cast<int>(elements.size() + pending.size());
+}
+
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::setWriteBuffering(bool enabled) {
+    buffering = enabled;
+    if (!enabled) {
+        flush();
+    }
+}
+
+// On-disk layout written by save(): this header, then elementCount sorted elements, then primeCount sorted
+// primes, all in the writer's native representation. The header keeps the payload 8-byte aligned.
+struct MagicalFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t elementBytes;
+    std::uint32_t elementSigned;
+    std::uint32_t byteOrder;   // BYTE_ORDER_MARK as the writer stored it
+    std::uint64_t elementCount;
+    std::uint64_t primeCount;
+    std::uint64_t checksum;    // Checksum64 over the payload
+};
+
+static_assert(sizeof(MagicalFileHeader) % sizeof(std::uint64_t) == 0);
+
+static const char FILE_MAGIC[8] = {'M', 'A', 'G', 'I', 'C', 'C', 'T', '\0'};
+static const std::uint32_t FILE_VERSION = 1;
+static const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::save(const std::string &path) const {
+    flush();
+    MagicalFileHeader header{};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.elementBytes = sizeof(T);
+    header.elementSigned = std::is_signed_v<T> ? 1U : 0U;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.elementCount = elements.size();
+    header.primeCount = primes.size();
+    Checksum64 checksum;
+    auto hashRun = [&checksum](const T *run, std::size_t count) { checksum.update(run, count * sizeof(T)); };
+    elements.forEachRun(hashRun);
+    primes.forEachRun(hashRun);
+    header.checksum = checksum.value();
+
+    std::string staging = path + ".tmp";
+    {
+        std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+        auto writeRun = [&out](const T *run, std::size_t count) {
+            out.write(reinterpret_cast<const char *>(run), static_cast<std::streamsize>(count * sizeof(T)));
+        };
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        elements.forEachRun(writeRun);
+        primes.forEachRun(writeRun);
+        out.flush();
+        if (!out) {
+            std::remove(staging.c_str());
+            throw std::runtime_error("cannot write " + staging);
+        }
+    }
+    if (std::rename(staging.c_str(), path.c_str()) != 0) {
+        std::remove(staging.c_str());
+        throw std::runtime_error("cannot replace " + path);
+    }
+}
+
+template<typename T, typename Allocator>
+BasicMagicalContainer<T, Allocator> BasicMagicalContainer<T, Allocator>::open(const std::string &path, bool verify,
+                                                                              const Allocator &allocator) {
+    auto file = std::make_shared<const MappedFile>(path);
+    MagicalFileHeader header{};
+    if (file->size() < sizeof(header)) {
+        throw std::runtime_error(path + ": truncated header");
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+        throw std::runtime_error(path + ": not a MagicalContainer file");
+    }
+    if (header.version != FILE_VERSION) {
+        throw std::runtime_error(path + ": unsupported version " + std::to_string(header.version));
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK) {
+        throw std::runtime_error(path + ": saved with a different byte order");
+    }
+    if (header.elementBytes != sizeof(T) || header.elementSigned != (std::is_signed_v<T> ? 1U : 0U)) {
+        throw std::runtime_error(path + ": saved with a different element type");
+    }
+    auto capacity = (file->size() - sizeof(header)) / sizeof(T);
+    if (header.elementCount > capacity || header.primeCount > capacity - header.elementCount ||
+        (header.elementCount + header.primeCount) * sizeof(T) != file->size() - sizeof(header)) {
+        throw std::runtime_error(path + ": size does not match its header");
+    }
+
+    const auto *payload = reinterpret_cast<const T *>(file->data() + sizeof(header));
+    auto elementCount = static_cast<std::size_t>(header.elementCount);
+    auto primeCount = static_cast<std::size_t>(header.primeCount);
+    if (verify) {
+        Checksum64 checksum;
+        checksum.update(payload, (elementCount + primeCount) * sizeof(T));
+        if (checksum.value() != header.checksum) {
+            throw std::runtime_error(path + ": checksum mismatch");
+        }
+        if (!std::is_sorted(payload, payload + elementCount) ||
+            !std::is_sorted(payload + elementCount, payload + elementCount + primeCount)) {
+            throw std::runtime_error(path + ": values out of order");
+        }
+    }
+
+    BasicMagicalContainer container(allocator);
+    container.elements.assignView(payload, elementCount, file);
+    container.primes.assignView(payload + elementCount, primeCount, file);
+    return container;
+}
+
+template<typename T, typename Allocator>
+MagicalContainerStats BasicMagicalContainer<T, Allocator>::stats() const {
+#ifdef MAGICAL_CONTAINER_STATS
+    return counters.snapshot();
+#else
+    return {};
+#endif
+}
+
+template<typename T, typename Allocator>
+[[gnu::noinline]] int BasicMagicalContainer<T, Allocator>::reanchor(const MagicalStorage<T, Allocator> &sorted, Anchor &anchor, int index) const {
+    flush();
+    anchor.generation = generation;
+    auto size = static_cast<int>(sorted.size());
+    if (anchor.index < 0) {
+        return std::min(index, size);
+    }
+    auto base = static_cast<int>(sorted.lowerBound(anchor.value));
+    bool present = base < size && sorted[static_cast<std::size_t>(base)] == anchor.value;
+    int distance = index - anchor.index;
+    anchor.index = present ? base : -1;
+    // A removed anchor leaves a gap that the first step past it would otherwise skip over
+    return std::clamp(base + distance - (present || distance <= 0 ? 0 : 1), 0, size);
 }
 
 // AscendingIterator
 
-MagicalContainer::AscendingIterator::AscendingIterator(const MagicalContainer& cont, int index)
-        : container(cont), currentIndex(index) {}
+template<typename T, typename Allocator>
+BasicMagicalContainer<T, Allocator>::AscendingIterator::AscendingIterator(const BasicMagicalContainer& cont, int index)
+        : container(&cont), currentIndex(index) {
+    anchor.generation = cont.generation;
+}
+
+// Only reads and comparisons sync. Moving the cursor just changes its distance from the anchor, which
+// re-anchoring accounts for, so the increment path stays free of the generation check.
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::AscendingIterator::sync() const {
+    if (container != nullptr && anchor.generation != container->generation) [[unlikely]] {
+        currentIndex = container->reanchor(container->elements, anchor, currentIndex);
+    }
+}
 
-MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::begin() const {
-    return AscendingIterator(container, 0);
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator BasicMagicalContainer<T, Allocator>::AscendingIterator::begin() const {
+    return AscendingIterator(*container, 0);
 }
 
-MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::end() const {
-    return AscendingIterator(container, container.size());
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator BasicMagicalContainer<T, Allocator>::AscendingIterator::end() const {
+    return AscendingIterator(*container, container->size());
 }
 
-MagicalContainer::AscendingIterator& MagicalContainer::AscendingIterator::operator++() {
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator& BasicMagicalContainer<T, Allocator>::AscendingIterator::operator++() {
+    MAGICAL_STAT(*container, iteratorIncrements, 1);
     ++currentIndex;
     return *this;
 }
 
-int MagicalContainer::AscendingIterator::operator*() const {
-    if (currentIndex >= container.size()) {
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator BasicMagicalContainer<T, Allocator>::AscendingIterator::operator++(int) {
+    AscendingIterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator& BasicMagicalContainer<T, Allocator>::AscendingIterator::operator--() {
+    --currentIndex;
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator BasicMagicalContainer<T, Allocator>::AscendingIterator::operator--(int) {
+    AscendingIterator previous = *this;
+    --*this;
+    return previous;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator& BasicMagicalContainer<T, Allocator>::AscendingIterator::operator+=(difference_type offset) {
+    currentIndex += static_cast<int>(offset);
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator& BasicMagicalContainer<T, Allocator>::AscendingIterator::operator-=(difference_type offset) {
+    currentIndex -= static_cast<int>(offset);
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator BasicMagicalContainer<T, Allocator>::AscendingIterator::operator+(difference_type offset) const {
+    AscendingIterator moved = *this;
+    return moved += offset;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator BasicMagicalContainer<T, Allocator>::AscendingIterator::operator-(difference_type offset) const {
+    AscendingIterator moved = *this;
+    return moved -= offset;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::AscendingIterator::difference_type BasicMagicalContainer<T, Allocator>::AscendingIterator::operator-(const AscendingIterator& other) const {
+    sync();
+    other.sync();
+    return currentIndex - other.currentIndex;
+}
+
+template<typename T, typename Allocator>
+T BasicMagicalContainer<T, Allocator>::AscendingIterator::operator*() const {
+    if (container != nullptr) {
+        container->flush();
+        sync();
+    }
+    if (container == nullptr || currentIndex < 0 || currentIndex >= static_cast<int>(container->elements.size())) {
+        if (container != nullptr) {
+            MAGICAL_STAT(*container, boundsExceptions, 1);
+        }
         throw std::out_of_range("Iterator out of range.");
     }
-    return container.elements[static_cast<std::vector<int>::size_type>(currentIndex)];
+    T value = container->elements[static_cast<std::size_t>(currentIndex)];
+    anchor.index = currentIndex;
+    anchor.value = value;
+    return value;
+}
+
+template<typename T, typename Allocator>
+T BasicMagicalContainer<T, Allocator>::AscendingIterator::operator[](difference_type offset) const {
+    return *(*this + offset);
 }
 
-bool MagicalContainer::AscendingIterator::operator==(const AscendingIterator& other) const {
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::AscendingIterator::operator==(const AscendingIterator& other) const {
+    sync();
+    other.sync();
     return currentIndex == other.currentIndex;
 }
 
-bool MagicalContainer::AscendingIterator::operator!=(const AscendingIterator& other) const {
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::AscendingIterator::operator!=(const AscendingIterator& other) const {
+    sync();
+    other.sync();
     return currentIndex != other.currentIndex;
 }
 
-bool MagicalContainer::AscendingIterator::operator>(const AscendingIterator& other) const {
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::AscendingIterator::operator>(const AscendingIterator& other) const {
+    sync();
+    other.sync();
     return currentIndex > other.currentIndex;
 }
 
-bool MagicalContainer::AscendingIterator::operator<(const AscendingIterator& other) const {
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::AscendingIterator::operator<(const AscendingIterator& other) const {
+    sync();
+    other.sync();
     return currentIndex < other.currentIndex;
 }
 
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::AscendingIterator::operator>=(const AscendingIterator& other) const {
+    sync();
+    other.sync();
+    return currentIndex >= other.currentIndex;
+}
+
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::AscendingIterator::operator<=(const AscendingIterator& other) const {
+    sync();
+    other.sync();
+    return currentIndex <= other.currentIndex;
+}
+
 // SideCrossIterator
 
-MagicalContainer::SideCrossIterator::SideCrossIterator(const MagicalContainer& cont, int forwardIndex,
-                                                       int backwardIndex, bool forwardDir, int counter)
-        : container(cont), forwardIndex(forwardIndex), backwardIndex(backwardIndex),
-          forwardDirection(forwardDir) ,counter(counter){}
+template<typename T, typename Allocator>
+BasicMagicalContainer<T, Allocator>::SideCrossIterator::SideCrossIterator(const BasicMagicalContainer& cont, int position)
+        : container(&cont), counter(position) {}
 
-MagicalContainer::SideCrossIterator MagicalContainer::SideCrossIterator::begin() const {
-    return SideCrossIterator(container, 0, container.size() - 1, true);
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator BasicMagicalContainer<T, Allocator>::SideCrossIterator::begin() const {
+    return SideCrossIterator(*container, 0);
 }
 
-MagicalContainer::SideCrossIterator MagicalContainer::SideCrossIterator::end() const {
-    return SideCrossIterator(container, container.size(), 0, false);
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator BasicMagicalContainer<T, Allocator>::SideCrossIterator::end() const {
+    return SideCrossIterator(*container, container->size());
 }
 
-MagicalContainer::SideCrossIterator& MagicalContainer::SideCrossIterator::operator++() {
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator BasicMagicalContainer<T, Allocator>::SideCrossIterator::seek(int position) const {
+    return SideCrossIterator(*container, position);
+}
 
-    if (forwardDirection) {
-        ++forwardIndex;
-    } else {
-        --backwardIndex;
-    }
-    forwardDirection = !forwardDirection;
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator& BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator++() {
+    MAGICAL_STAT(*container, iteratorIncrements, 1);
     ++counter;
+    return *this;
+}
 
-    // Check if the counter reaches a specific value
-    if (counter >= container.size()) {
-        forwardIndex = container.size();
-        backwardIndex = 0;
-    }
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator++(int) {
+    SideCrossIterator previous = *this;
+    ++*this;
+    return previous;
+}
 
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator& BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator--() {
+    --counter;
     return *this;
 }
 
-int MagicalContainer::SideCrossIterator::operator*() const {
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator--(int) {
+    SideCrossIterator previous = *this;
+    --*this;
+    return previous;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator& BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator+=(difference_type offset) {
+    counter += static_cast<int>(offset);
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator& BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator-=(difference_type offset) {
+    counter -= static_cast<int>(offset);
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator+(difference_type offset) const {
+    SideCrossIterator moved = *this;
+    return moved += offset;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator-(difference_type offset) const {
+    SideCrossIterator moved = *this;
+    return moved -= offset;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::SideCrossIterator::difference_type BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator-(const SideCrossIterator& other) const {
+    return counter - other.counter;
+}
 
-    if(forwardIndex >= container.size() || backwardIndex < 0) {
+template<typename T, typename Allocator>
+T BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator*() const {
+    if (container != nullptr) {
+        container->flush();
+    }
+    if (container == nullptr || counter < 0 || counter >= container->size()) {
+        if (container != nullptr) {
+            MAGICAL_STAT(*container, boundsExceptions, 1);
+        }
         throw std::out_of_range("Iterator out of range.");
     }
 
-    if (forwardDirection) {
-        return container.elements[static_cast<std::vector<int>::size_type>(forwardIndex)];
-    }
-    else {
-        return container.elements[static_cast<std::vector<int>::size_type>(backwardIndex)];
+    auto half = static_cast<std::size_t>(counter / 2);
+    if (counter % 2 == 0) {
+        return container->elements[half];
     }
+    return container->elements[container->elements.size() - 1 - half];
+}
+
+template<typename T, typename Allocator>
+T BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator[](difference_type offset) const {
+    return *(*this + offset);
 }
 
+// Iterators are ordered by their position in the cross order, not by the element they point at
 
-bool MagicalContainer::SideCrossIterator::operator==(const SideCrossIterator& other) const {
-    return forwardIndex == other.forwardIndex && backwardIndex == other.backwardIndex &&
-           forwardDirection == other.forwardDirection;
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator==(const SideCrossIterator& other) const {
+    return counter == other.counter;
 }
 
-bool MagicalContainer::SideCrossIterator::operator!=(const SideCrossIterator& other) const {
-    return forwardIndex != other.forwardIndex || backwardIndex != other.backwardIndex ||
-           forwardDirection != other.forwardDirection;
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator!=(const SideCrossIterator& other) const {
+    return counter != other.counter;
 }
 
-bool MagicalContainer::SideCrossIterator::operator>(const SideCrossIterator& other) const {
-    return forwardIndex > other.forwardIndex && backwardIndex > other.backwardIndex;
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator>(const SideCrossIterator& other) const {
+    return counter > other.counter;
 }
 
-bool MagicalContainer::SideCrossIterator::operator<(const SideCrossIterator& other) const {
-    return forwardIndex < other.forwardIndex && backwardIndex < other.backwardIndex;
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator<(const SideCrossIterator& other) const {
+    return counter < other.counter;
+}
+
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator>=(const SideCrossIterator& other) const {
+    return counter >= other.counter;
+}
+
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::SideCrossIterator::operator<=(const SideCrossIterator& other) const {
+    return counter <= other.counter;
 }
 
 // PrimeIterator
 
-bool MagicalContainer::PrimeIterator::isPrime(int number) {
-    if (number < 2) {
-        return false;
-    }
-    double sqrtNum = std::sqrt(number);
-    for (int i = 2; i <= sqrtNum; ++i) {
-        if (number % i == 0) {
-            return false;
-        }
+template<typename T, typename Allocator>
+BasicMagicalContainer<T, Allocator>::PrimeIterator::PrimeIterator(const BasicMagicalContainer& cont, int index)
+        : container(&cont), currentIndex(index) {
+    anchor.generation = cont.generation;
+}
+
+template<typename T, typename Allocator>
+void BasicMagicalContainer<T, Allocator>::PrimeIterator::sync() const {
+    if (container != nullptr && anchor.generation != container->generation) [[unlikely]] {
+        currentIndex = container->reanchor(container->primes, anchor, currentIndex);
     }
-    return true;
 }
 
-MagicalContainer::PrimeIterator::PrimeIterator(const MagicalContainer& cont, int index)
-        : container(cont), currentIndex(index) {}
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator BasicMagicalContainer<T, Allocator>::PrimeIterator::begin() const {
+    return PrimeIterator(*container, 0);
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator BasicMagicalContainer<T, Allocator>::PrimeIterator::end() const {
+    // Which buffered inserts are prime is only known after the merge
+    container->flush();
+    return PrimeIterator(*container, static_cast<int>(container->primes.size()));
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator& BasicMagicalContainer<T, Allocator>::PrimeIterator::operator++() {
+    MAGICAL_STAT(*container, iteratorIncrements, 1);
+    // currentIndex points into the container's prime index, so the next prime is always one step away
+    ++currentIndex;
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator BasicMagicalContainer<T, Allocator>::PrimeIterator::operator++(int) {
+    PrimeIterator previous = *this;
+    ++*this;
+    return previous;
+}
 
-MagicalContainer::PrimeIterator MagicalContainer::PrimeIterator::begin() const {
-    return PrimeIterator(container, 0);
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator& BasicMagicalContainer<T, Allocator>::PrimeIterator::operator--() {
+    --currentIndex;
+    return *this;
 }
 
-MagicalContainer::PrimeIterator MagicalContainer::PrimeIterator::end() const {
-    return PrimeIterator(container, container.size());
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator BasicMagicalContainer<T, Allocator>::PrimeIterator::operator--(int) {
+    PrimeIterator previous = *this;
+    --*this;
+    return previous;
 }
 
-MagicalContainer::PrimeIterator& MagicalContainer::PrimeIterator::operator++() {
-    do {
-        ++currentIndex;
-    } while (currentIndex < container.size() && !isPrime(container.elements[static_cast<std::vector<int>::size_type>(currentIndex)]));
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator& BasicMagicalContainer<T, Allocator>::PrimeIterator::operator+=(difference_type offset) {
+    currentIndex += static_cast<int>(offset);
     return *this;
 }
 
-int MagicalContainer::PrimeIterator::operator*() const {
-    if (currentIndex >= container.size()) {
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator& BasicMagicalContainer<T, Allocator>::PrimeIterator::operator-=(difference_type offset) {
+    currentIndex -= static_cast<int>(offset);
+    return *this;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator BasicMagicalContainer<T, Allocator>::PrimeIterator::operator+(difference_type offset) const {
+    PrimeIterator moved = *this;
+    return moved += offset;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator BasicMagicalContainer<T, Allocator>::PrimeIterator::operator-(difference_type offset) const {
+    PrimeIterator moved = *this;
+    return moved -= offset;
+}
+
+template<typename T, typename Allocator>
+typename BasicMagicalContainer<T, Allocator>::PrimeIterator::difference_type BasicMagicalContainer<T, Allocator>::PrimeIterator::operator-(const PrimeIterator& other) const {
+    sync();
+    other.sync();
+    return currentIndex - other.currentIndex;
+}
+
+template<typename T, typename Allocator>
+T BasicMagicalContainer<T, Allocator>::PrimeIterator::operator*() const {
+    if (container != nullptr) {
+        container->flush();
+        sync();
+    }
+    if (container == nullptr || currentIndex < 0 || currentIndex >= static_cast<int>(container->primes.size())) {
+        if (container != nullptr) {
+            MAGICAL_STAT(*container, boundsExceptions, 1);
+        }
         throw std::out_of_range("Iterator out of range.");
     }
-    return container.elements[static_cast<std::vector<int>::size_type>(currentIndex)];
+    T value = container->primes[static_cast<std::size_t>(currentIndex)];
+    anchor.index = currentIndex;
+    anchor.value = value;
+    return value;
+}
+
+template<typename T, typename Allocator>
+T BasicMagicalContainer<T, Allocator>::PrimeIterator::operator[](difference_type offset) const {
+    return *(*this + offset);
 }
 
-bool MagicalContainer::PrimeIterator::operator==(const PrimeIterator& other) const {
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::PrimeIterator::operator==(const PrimeIterator& other) const {
+    sync();
+    other.sync();
     return currentIndex == other.currentIndex;
 }
 
-bool MagicalContainer::PrimeIterator::operator!=(const PrimeIterator& other) const {
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::PrimeIterator::operator!=(const PrimeIterator& other) const {
+    sync();
+    other.sync();
     return currentIndex != other.currentIndex;
 }
 
-bool MagicalContainer::PrimeIterator::operator>(const PrimeIterator& other) const {
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::PrimeIterator::operator>(const PrimeIterator& other) const {
+    sync();
+    other.sync();
     return currentIndex > other.currentIndex;
 }
 
-bool MagicalContainer::PrimeIterator::operator<(const PrimeIterator& other) const {
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::PrimeIterator::operator<(const PrimeIterator& other) const {
+    sync();
+    other.sync();
     return currentIndex < other.currentIndex;
 }
 
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::PrimeIterator::operator>=(const PrimeIterator& other) const {
+    sync();
+    other.sync();
+    return currentIndex >= other.currentIndex;
+}
+
+template<typename T, typename Allocator>
+bool BasicMagicalContainer<T, Allocator>::PrimeIterator::operator<=(const PrimeIterator& other) const {
+    sync();
+    other.sync();
+    return currentIndex <= other.currentIndex;
+}
+
+template class BasicMagicalContainer<std::int32_t>;
+template class BasicMagicalContainer<std::int64_t>;
+template class BasicMagicalContainer<std::uint64_t>;
+template class BasicMagicalContainer<std::int32_t, std::pmr::polymorphic_allocator<std::int32_t>>;
+template class BasicMagicalContainer<std::int64_t, std::pmr::polymorphic_allocator<std::int64_t>>;
+template class BasicMagicalContainer<std::uint64_t, std::pmr::polymorphic_allocator<std::uint64_t>>;
+
+static_assert(std::random_access_iterator<MagicalContainer::AscendingIterator>);
+static_assert(std::random_access_iterator<MagicalContainer::SideCrossIterator>);
+static_assert(std::random_access_iterator<MagicalContainer::PrimeIterator>);
+static_assert(std::ranges::random_access_range<MagicalContainer::AscendingIterator>);
+static_assert(std::ranges::random_access_range<MagicalContainer::SideCrossIterator>);
+static_assert(std::ranges::random_access_range<MagicalContainer::PrimeIterator>);
+static_assert(std::ranges::sized_range<MagicalContainer::AscendingIterator>);
@@ -2,21 +2,255 @@
 #define MAGICALCONTAINER_H
 
 #include <vector>
-#include <cmath>
+#include <cstdint>
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "PrimalityOracle.hpp"
+#include "SortedStorage.hpp"
 
 namespace ariel {}
-class MagicalContainer {
+
+// Snapshot of MagicalContainer's hot-path counters. They are only collected when built with
+// -DMAGICAL_CONTAINER_STATS; otherwise every field stays zero and counting compiles away.
+struct MagicalContainerStats {
+    std::uint64_t inserts = 0;
+    std::uint64_t removes = 0;
+    std::uint64_t sorts = 0;
+    std::uint64_t elementMoves = 0;
+    std::uint64_t primalityTests = 0;      // values tested with Miller-Rabin
+    std::uint64_t primalityCached = 0;     // values answered by the sieve
+    std::uint64_t iteratorIncrements = 0;
+    std::uint64_t boundsExceptions = 0;    // out_of_range thrown from operator*
+};
+
+#ifdef MAGICAL_CONTAINER_STATS
+// One hot-path counter. Const reads bump it too, and those may run on several threads at once, so it is
+// a relaxed atomic: totals are exact, but carry no ordering with the container's contents.
+class MagicalCounter {
+private:
+    std::atomic<std::uint64_t> value{0};
+
+public:
+    MagicalCounter() = default;
+
+    MagicalCounter(const MagicalCounter &other) : value(other.load()) {}
+
+    MagicalCounter &operator=(const MagicalCounter &other) {
+        value.store(other.load(), std::memory_order_relaxed);
+        return *this;
+    }
+
+    ~MagicalCounter() = default;
+
+    void add(std::uint64_t amount) { value.fetch_add(amount, std::memory_order_relaxed); }
+
+    [[nodiscard]] std::uint64_t load() const { return value.load(std::memory_order_relaxed); }
+};
+
+struct MagicalContainerCounters {
+    MagicalCounter inserts;
+    MagicalCounter removes;
+    MagicalCounter sorts;
+    MagicalCounter elementMoves;
+    MagicalCounter primalityTests;
+    MagicalCounter primalityCached;
+    MagicalCounter iteratorIncrements;
+    MagicalCounter boundsExceptions;
+
+    [[nodiscard]] MagicalContainerStats snapshot() const {
+        return {inserts.load(), removes.load(), sorts.load(), elementMoves.load(), primalityTests.load(),
+                primalityCached.load(), iteratorIncrements.load(), boundsExceptions.load()};
+    }
+};
+#endif
+
+// The three orders the container's iterators walk, for the bulk exports that bypass them
+enum class MagicalOrder {
+    Ascending,
+    SideCross,
+    Prime
+};
+
+// Sorted storage backend, chosen at build time. -DMAGICAL_CONTAINER_BLOCKS switches from one flat vector
+// to page-sized sorted blocks, which keeps inserts and removes cheap at millions of elements, and
+// -DMAGICAL_CONTAINER_PACKED to delta-encoded blocks, which fits a huge read-mostly container in a
+// fraction of the memory at the cost of decoding on every block boundary a read crosses. The flat
+// vector keeps its first MAGICAL_CONTAINER_INLINE_CAPACITY elements, and as many primes, inside the
+// container object, so small containers never allocate; 0 turns that off.
+#ifndef MAGICAL_CONTAINER_INLINE_CAPACITY
+#define MAGICAL_CONTAINER_INLINE_CAPACITY 16
+#endif
+
+#if defined(MAGICAL_CONTAINER_BLOCKS) && defined(MAGICAL_CONTAINER_PACKED)
+#error "MAGICAL_CONTAINER_BLOCKS and MAGICAL_CONTAINER_PACKED pick different storage backends"
+#elif defined(MAGICAL_CONTAINER_BLOCKS)
+template<typename T, typename Allocator>
+using MagicalStorage = SortedBlocks<T, Allocator>;
+#elif defined(MAGICAL_CONTAINER_PACKED)
+template<typename T, typename Allocator>
+using MagicalStorage = SortedPacked<T, Allocator>;
+#else
+template<typename T, typename Allocator>
+using MagicalStorage = SortedVector<T, Allocator, MAGICAL_CONTAINER_INLINE_CAPACITY>;
+#endif
+
+// Sorted container of integral elements. Definitions live in MagicalContainer.cpp and are explicitly
+// instantiated for int32_t, int64_t and uint64_t, each with std::allocator and std::pmr::polymorphic_allocator.
+// Every per-element buffer (storage, prime index, write buffer and search index) comes from the allocator;
+// only the primality sieve stays on the global heap. Like std containers, a copy asks the allocator's
+// select_on_container_copy_construction, so a copied pmr container uses the default resource.
+template<typename T, typename Allocator = std::allocator<T>>
+class BasicMagicalContainer {
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "elements must be integers");
+
 private:
-    std::vector<int> elements;
+    // The sorted storage is mutable so reads can merge the write buffer in before they look at it
+    mutable MagicalStorage<T, Allocator> elements;
+    // Sorted copy of the prime elements, kept in step with elements so PrimeIterator never tests primality
+    mutable MagicalStorage<T, Allocator> primes;
+    // Sieve over the dense part of the value range, refreshed by bulk loads and shared by every insert
+    mutable PrimalityOracle primeOracle;
+    // Unsorted inserts waiting for the next read while write buffering is on
+    mutable std::vector<T, Allocator> pending;
+    bool buffering = false;
+    // Bumped by every change to the sorted storage; iterators compare it to notice they must re-anchor
+    mutable std::uint64_t generation = 0;
+    // Optional Eytzinger copy of elements for lookups, only used while its generation is current
+    EytzingerIndex<T, Allocator> searchIndex;
+    std::uint64_t searchIndexGeneration = 0;
+#ifdef MAGICAL_CONTAINER_STATS
+    mutable MagicalContainerCounters counters;
+#endif
+
+    // Where a value-ordered iterator stood when it last looked at the storage
+    struct Anchor {
+        std::uint64_t generation = 0;
+        int index = -1;  // index of the last dereferenced element, or -1 if there is none
+        T value{};       // that element
+    };
+
+    // New index for an iterator at index after the storage changed under anchor. The last dereferenced value
+    // is found again by binary search and the iterator keeps its distance from it, so inserts and removals
+    // before the cursor cause neither repeats nor skips. Equal values are indistinguishable, so within a run
+    // of duplicates the anchor falls back to the first copy.
+    [[nodiscard]] int reanchor(const MagicalStorage<T, Allocator> &sorted, Anchor &anchor, int index) const;
+
+    [[nodiscard]] bool testPrime(T number) const;
+
+    void mergePending() const;
+
+    template<bool OrEqual = false>
+    [[nodiscard]] std::size_t rank(T value) const;
 
 public:
-    void addElement(int element);
+    using value_type = T;
+    using allocator_type = Allocator;
+
+    static constexpr bool stableRuns = MagicalStorage<T, Allocator>::STABLE_RUNS;
+
+    BasicMagicalContainer() : BasicMagicalContainer(Allocator()) {}
+
+    explicit BasicMagicalContainer(const Allocator &allocator);
+
+    [[nodiscard]] allocator_type get_allocator() const { return pending.get_allocator(); }
+
+    // Picks the 32- or 64-bit Miller-Rabin kernel from the width of T at compile time
+    [[nodiscard]] static bool isPrime(T number);
+
+    [[nodiscard]] static bool isPrime64(std::uint64_t number);
 
-    void removeElement(int element);
+    void addElement(T element);
 
+    void addElements(std::vector<T> batch);
+
+    template<typename InputIt>
+    void addElements(InputIt first, InputIt last) {
+        addElements(std::vector<T>(first, last));
+    }
+
+    void removeElement(T element);
+
+    void removeElements(std::vector<T> victims);
+
+    template<typename InputIt>
+    void removeElements(InputIt first, InputIt last) {
+        removeElements(std::vector<T>(first, last));
+    }
+
+    [[nodiscard]] bool contains(T element) const;
+
+    // Position of the first element not below element in ascending order, or size() if there is none
+    [[nodiscard]] int lowerBound(T element) const;
+
+    // Number of elements in [low, high], both ends included
+    [[nodiscard]] int countInRange(T low, T high) const;
+
+    // Builds an Eytzinger-ordered copy of the elements that the lookups above use until the next mutation.
+    // Worth it for large containers queried many times between changes; costs one more copy of the data.
+    void buildSearchIndex();
+
+    // Appends every prime element to out in ascending order. The prime index is already dense and sorted,
+    // so this is a straight copy with no primality testing and no per-element iterator calls.
+    void collectPrimes(std::vector<T> &out) const;
+
+    // Writes the elements and the prime index to path as one versioned, checksummed file. The file is
+    // written beside path and renamed over it, so readers never see a partial file.
+    void save(const std::string &path) const;
+
+    // Maps a file written by save() read-only and serves it in place: opening costs O(1) beyond the checksum
+    // pass, and iterators read straight from the mapped pages. The first mutation copies the data into
+    // memory and the file is never written. With verify off the checksum and order checks are skipped, which
+    // makes opening independent of the file size. Throws std::runtime_error for a missing, truncated or
+    // corrupt file, or one saved with a different element type or byte order. The blocks and packed backends
+    // copy the file into their own blocks instead of mapping it.
+    [[nodiscard]] static BasicMagicalContainer open(const std::string &path, bool verify = true,
+                                                    const Allocator &allocator = Allocator());
+
+    // Copies the elements of order from position from onwards into out, as many as fit, and returns how many
+    // it copied. The sorted orders are straight copies of the storage; the cross order is gathered with two
+    // strided passes, one per half, instead of one closed-form index per element.
+    std::size_t exportTo(std::span<T> out, MagicalOrder order, std::size_t from = 0) const;
+
+    // Calls visit(const T *, std::size_t) on the contiguous runs that make up the ascending or prime order,
+    // pointing into the storage itself so writers can hand them to the kernel without a copy. The runs are
+    // valid until the next mutation, or with stableRuns false only until visit returns, since the packed
+    // backend hands out blocks it has just decoded into a buffer. Throws std::invalid_argument for MagicalOrder::SideCross, which
+    // interleaves the two ends of the storage and so has no contiguous runs.
+    template<typename Visitor>
+    void forEachRun(MagicalOrder order, Visitor visit) const {
+        if (order == MagicalOrder::SideCross) {
+            throw std::invalid_argument("the cross order has no contiguous runs");
+        }
+        flush();
+        (order == MagicalOrder::Prime ? primes : elements).forEachRun(visit);
+    }
+
+    // Counts buffered inserts too, so it never forces a merge
     [[nodiscard]] int size() const;
 
+    // With buffering on, addElement only appends to a staging area that is sorted and merged in one pass on
+    // the next iterator read, removal or flush(). Turning it off flushes. The concurrent wrappers keep it off,
+    // since a merge from a read would race with other readers.
+    void setWriteBuffering(bool enabled);
+
+    [[nodiscard]] bool writeBuffering() const { return buffering; }
+
+    void flush() const {
+        if (!pending.empty()) [[unlikely]] {
+            mergePending();
+        }
+    }
+
+    [[nodiscard]] MagicalContainerStats stats() const;
+
     class AscendingIterator;
 
     class SideCrossIterator;
@@ -25,21 +259,72 @@ public:
 
 };
 
-class MagicalContainer::AscendingIterator {
+using MagicalContainer = BasicMagicalContainer<int>;
+
+// Containers drawing memory from a std::pmr::memory_resource, such as a per-request arena or pool
+template<typename T>
+using PmrBasicMagicalContainer = BasicMagicalContainer<T, std::pmr::polymorphic_allocator<T>>;
+
+using PmrMagicalContainer = PmrBasicMagicalContainer<int>;
+
+template<typename T, typename Allocator>
+class BasicMagicalContainer<T, Allocator>::AscendingIterator {
 private:
-    const MagicalContainer &container;
-    int currentIndex;
+    const BasicMagicalContainer *container = nullptr;
+    // Reads re-anchor the cursor after a mutation, so even const operations may move it
+    mutable int currentIndex = 0;
+    mutable Anchor anchor;
+
+    void sync() const;
 
 public:
-    explicit AscendingIterator(const MagicalContainer &cont, int index = 0);
+    // operator* yields elements by value, so the legacy category is nominal; it lets std::distance,
+    // std::advance and std::lower_bound take their O(1) paths
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = T;
+
+    AscendingIterator() = default;
+
+    explicit AscendingIterator(const BasicMagicalContainer &cont, int index = 0);
 
     [[nodiscard]] AscendingIterator begin() const;
 
     [[nodiscard]] AscendingIterator end() const;
 
+    // Merges the container's buffered inserts now, so reads through copies of this iterator never write
+    void flush() const {
+        if (container != nullptr) {
+            container->flush();
+        }
+    }
+
     AscendingIterator &operator++();
 
-    int operator*() const;
+    AscendingIterator operator++(int);
+
+    AscendingIterator &operator--();
+
+    AscendingIterator operator--(int);
+
+    AscendingIterator &operator+=(difference_type offset);
+
+    AscendingIterator &operator-=(difference_type offset);
+
+    AscendingIterator operator+(difference_type offset) const;
+
+    AscendingIterator operator-(difference_type offset) const;
+
+    friend AscendingIterator operator+(difference_type offset, const AscendingIterator &iter) { return iter + offset; }
+
+    difference_type operator-(const AscendingIterator &other) const;
+
+    T operator*() const;
+
+    T operator[](difference_type offset) const;
 
     bool operator==(const AscendingIterator &other) const;
 
@@ -48,27 +333,70 @@ public:
     bool operator>(const AscendingIterator &other) const;
 
     bool operator<(const AscendingIterator &other) const;
+
+    bool operator>=(const AscendingIterator &other) const;
+
+    bool operator<=(const AscendingIterator &other) const;
 };
 
-class MagicalContainer::SideCrossIterator {
+template<typename T, typename Allocator>
+class BasicMagicalContainer<T, Allocator>::SideCrossIterator {
 private:
-    const MagicalContainer &container;
-    int forwardIndex;
-    int backwardIndex;
-    bool forwardDirection;
-    int counter;
+    const BasicMagicalContainer *container = nullptr;
+    // Offset k in the cross order; it maps to element k / 2 when k is even and n - 1 - k / 2 when odd
+    int counter = 0;
 
 public:
-    explicit SideCrossIterator(const MagicalContainer &cont, int forwardIndex = 0, int backwardIndex = 0,
-                               bool forwardDir = true, int counter = 0);
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = T;
+
+    SideCrossIterator() = default;
+
+    explicit SideCrossIterator(const BasicMagicalContainer &cont, int position = 0);
 
     [[nodiscard]] SideCrossIterator begin() const;
 
     [[nodiscard]] SideCrossIterator end() const;
 
+    // Merges the container's buffered inserts now, so reads through copies of this iterator never write
+    void flush() const {
+        if (container != nullptr) {
+            container->flush();
+        }
+    }
+
+    // Iterator at an absolute cross offset, in O(1)
+    [[nodiscard]] SideCrossIterator seek(int position) const;
+
+    [[nodiscard]] int position() const { return counter; }
+
     SideCrossIterator &operator++();
 
-    int operator*() const;
+    SideCrossIterator operator++(int);
+
+    SideCrossIterator &operator--();
+
+    SideCrossIterator operator--(int);
+
+    SideCrossIterator &operator+=(difference_type offset);
+
+    SideCrossIterator &operator-=(difference_type offset);
+
+    SideCrossIterator operator+(difference_type offset) const;
+
+    SideCrossIterator operator-(difference_type offset) const;
+
+    friend SideCrossIterator operator+(difference_type offset, const SideCrossIterator &iter) { return iter + offset; }
+
+    difference_type operator-(const SideCrossIterator &other) const;
+
+    T operator*() const;
+
+    T operator[](difference_type offset) const;
 
     bool operator==(const SideCrossIterator &other) const;
 
@@ -77,25 +405,67 @@ public:
     bool operator>(const SideCrossIterator &other) const;
 
     bool operator<(const SideCrossIterator &other) const;
+
+    bool operator>=(const SideCrossIterator &other) const;
+
+    bool operator<=(const SideCrossIterator &other) const;
 };
 
-class MagicalContainer::PrimeIterator {
+template<typename T, typename Allocator>
+class BasicMagicalContainer<T, Allocator>::PrimeIterator {
 private:
-    const MagicalContainer &container;
-    int currentIndex;
+    const BasicMagicalContainer *container = nullptr;
+    mutable int currentIndex = 0;  // position in the container's prime index
+    mutable Anchor anchor;
 
-    [[nodiscard]] static bool isPrime(int number) ;
+    void sync() const;
 
 public:
-    explicit PrimeIterator(const MagicalContainer &cont, int index = 0);
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = T;
+
+    PrimeIterator() = default;
+
+    explicit PrimeIterator(const BasicMagicalContainer &cont, int index = 0);
 
     [[nodiscard]] PrimeIterator begin() const;
 
     [[nodiscard]] PrimeIterator end() const;
 
+    // Merges the container's buffered inserts now, so reads through copies of this iterator never write
+    void flush() const {
+        if (container != nullptr) {
+            container->flush();
+        }
+    }
+
     PrimeIterator &operator++();
 
-    int operator*() const;
+    PrimeIterator operator++(int);
+
+    PrimeIterator &operator--();
+
+    PrimeIterator operator--(int);
+
+    PrimeIterator &operator+=(difference_type offset);
+
+    PrimeIterator &operator-=(difference_type offset);
+
+    PrimeIterator operator+(difference_type offset) const;
+
+    PrimeIterator operator-(difference_type offset) const;
+
+    friend PrimeIterator operator+(difference_type offset, const PrimeIterator &iter) { return iter + offset; }
+
+    difference_type operator-(const PrimeIterator &other) const;
+
+    T operator*() const;
+
+    T operator[](difference_type offset) const;
 
     bool operator==(const PrimeIterator &other) const;
 
@@ -104,7 +474,17 @@ public:
     bool operator>(const PrimeIterator &other) const;
 
     bool operator<(const PrimeIterator &other) const;
+
+    bool operator>=(const PrimeIterator &other) const;
+
+    bool operator<=(const PrimeIterator &other) const;
 };
 
+extern template class BasicMagicalContainer<std::int32_t>;
+extern template class BasicMagicalContainer<std::int64_t>;
+extern template class BasicMagicalContainer<std::uint64_t>;
+extern template class BasicMagicalContainer<std::int32_t, std::pmr::polymorphic_allocator<std::int32_t>>;
+extern template class BasicMagicalContainer<std::int64_t, std::pmr::polymorphic_allocator<std::int64_t>>;
+extern template class BasicMagicalContainer<std::uint64_t, std::pmr::polymorphic_allocator<std::uint64_t>>;
 
 #endif  // MAGICALCONTAINER_H
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MappedFile.hpp"
+
+MappedFile::MappedFile(const std::string &path) {
+    int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+    }
+    struct stat info{};
+    if (::fstat(descriptor, &info) != 0) {
+        int error = errno;
+        ::close(descriptor);
+        throw std::system_error(error, std::generic_category(), "cannot stat " + path);
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    if (length > 0) {
+        address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0);
+        if (address == MAP_FAILED) {
+            int error = errno;
+            ::close(descriptor);
+            address = nullptr;
+            throw std::system_error(error, std::generic_category(), "cannot map " + path);
+        }
+    }
+    // The mapping keeps the pages reachable on its own
+    ::close(descriptor);
+}
+
+MappedFile::~MappedFile() {
+    if (address != nullptr) {
+        ::munmap(address, length);
+    }
+}
+
+static const std::uint64_t CHECKSUM_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+
+void Checksum64::mix(std::uint64_t word) {
+    hash ^= word * CHECKSUM_MULTIPLIER;
+    hash = (hash << 31U) | (hash >> 33U);
+    hash *= 0xBF58476D1CE4E5B9ULL;
+}
+
+void Checksum64::update(const void *data, std::size_t size) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    total += size;
+    // Top up a word left over from the previous call first
+    if (carried > 0) {
+        std::size_t take = std::min(sizeof(carry) - carried, size);
+        std::memcpy(carry + carried, bytes, take);
+        carried += take;
+        bytes += take;
+        size -= take;
+        if (carried < sizeof(carry)) {
+            return;
+        }
+        std::uint64_t word = 0;
+        std::memcpy(&word, carry, sizeof(word));
+        mix(word);
+        carried = 0;
+    }
+    for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t), bytes += sizeof(std::uint64_t)) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes, sizeof(word));
+        mix(word);
+    }
+    std::memcpy(carry, bytes, size);
+    carried = size;
+}
+
+std::uint64_t Checksum64::value() const {
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, carry, carried);
+    std::uint64_t result = hash ^ (total * CHECKSUM_MULTIPLIER) ^ tail;
+    result *= 0x94D049BB133111EBULL;
+    return result ^ (result >> 29U);
+}
@@ -0,0 +1,48 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Whole file mapped read-only for as long as the object lives. Throws std::system_error if the file cannot
+// be opened or mapped.
+class MappedFile {
+private:
+    void *address = nullptr;
+    std::size_t length = 0;
+
+public:
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    [[nodiscard]] const std::byte *data() const { return static_cast<const std::byte *>(address); }
+
+    [[nodiscard]] std::size_t size() const { return length; }
+};
+
+// Order-dependent 64-bit hash for file payloads, fed incrementally and mixed eight bytes per step. The
+// result depends only on the byte sequence, not on how it was split across update() calls.
+class Checksum64 {
+private:
+    std::uint64_t hash;
+    std::uint64_t total = 0;
+    unsigned char carry[sizeof(std::uint64_t)] = {};
+    std::size_t carried = 0;
+
+    void mix(std::uint64_t word);
+
+public:
+    explicit Checksum64(std::uint64_t seed = 0) : hash(seed) {}
+
+    void update(const void *data, std::size_t size);
+
+    [[nodiscard]] std::uint64_t value() const;
+};
+
+#endif  // MAPPEDFILE_H
@@ -0,0 +1,51 @@
+#ifndef PARALLELTRAVERSAL_H
+#define PARALLELTRAVERSAL_H
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "MagicalContainer.hpp"
+#include "ThreadPool.hpp"
+
+// Splits the traversal of any container iterator into at most `chunks` disjoint [first, last) ranges
+// whose lengths differ by at most one. Lengths are counted in the iterator's own order, so PrimeIterator
+// chunks are balanced over the prime index rather than over all elements. Empty chunks are dropped.
+// Buffered inserts are merged first, so reading the chunks from several threads never merges from a read.
+template<typename Iterator>
+std::vector<std::pair<Iterator, Iterator>> partitionTraversal(const Iterator &iter, int chunks) {
+    iter.flush();
+    std::vector<std::pair<Iterator, Iterator>> ranges;
+    Iterator first = iter.begin();
+    auto total = iter.end() - first;
+    auto count = static_cast<decltype(total)>(std::max(chunks, 1));
+    for (decltype(total) chunk = 0; chunk < count; ++chunk) {
+        Iterator chunkBegin = first + total * chunk / count;
+        Iterator chunkEnd = first + total * (chunk + 1) / count;
+        if (chunkBegin != chunkEnd) {
+            ranges.emplace_back(chunkBegin, chunkEnd);
+        }
+    }
+    return ranges;
+}
+
+// Calls function on every element of the traversal, one chunk per task on the pool, so function must be
+// safe to call concurrently. The container must not be modified until it returns; the order of calls
+// across chunks is unspecified. chunks defaults to one per pool thread.
+template<typename Iterator, typename Function>
+void parallelForEach(const Iterator &iter, Function function, ThreadPool &pool, int chunks = 0) {
+    if (chunks <= 0) {
+        chunks = static_cast<int>(pool.threadCount());
+    }
+    std::vector<std::function<void()>> tasks;
+    for (const auto &range: partitionTraversal(iter, chunks)) {
+        tasks.emplace_back([range, &function] {
+            for (Iterator it = range.first; it != range.second; ++it) {
+                function(*it);
+            }
+        });
+    }
+    pool.run(std::move(tasks));
+}
+
+#endif  // PARALLELTRAVERSAL_H
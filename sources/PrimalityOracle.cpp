@@ -0,0 +1,149 @@
+#include <algorithm>
+#include "PrimalityOracle.hpp"
+
+// Trial division by these catches most composites before the Miller-Rabin rounds
+static const std::uint32_t SMALL_PRIMES[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+// Witness sets that make Miller-Rabin deterministic below 2^32 and below 2^64
+static const std::uint64_t WITNESSES_32[] = {2, 7, 61};
+static const std::uint64_t WITNESSES_64[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+// Product is a type wide enough to hold the product of two residues
+template<typename Product>
+static std::uint64_t mulMod(std::uint64_t lhs, std::uint64_t rhs, std::uint64_t mod) {
+    return static_cast<std::uint64_t>(static_cast<Product>(lhs) * rhs % mod);
+}
+
+template<typename Product>
+static std::uint64_t powMod(std::uint64_t base, std::uint64_t exp, std::uint64_t mod) {
+    std::uint64_t result = 1;
+    base %= mod;
+    while (exp > 0) {
+        if (exp & 1U) {
+            result = mulMod<Product>(result, base, mod);
+        }
+        base = mulMod<Product>(base, base, mod);
+        exp >>= 1U;
+    }
+    return result;
+}
+
+template<typename Product, std::size_t Count>
+static bool millerRabin(std::uint64_t number, const std::uint64_t (&witnesses)[Count]) {
+    for (std::uint32_t prime: SMALL_PRIMES) {
+        if (number % prime == 0) {
+            return number == prime;
+        }
+    }
+    if (number < 2) {
+        return false;
+    }
+    // No factor up to 37 means no factor below the next prime's square
+    if (number < 41 * 41) {
+        return true;
+    }
+
+    // number - 1 = odd * 2^twos
+    std::uint64_t odd = number - 1;
+    int twos = 0;
+    while ((odd & 1U) == 0) {
+        odd >>= 1U;
+        ++twos;
+    }
+
+    for (std::uint64_t witness: witnesses) {
+        std::uint64_t x = powMod<Product>(witness, odd, number);
+        if (x == 0 || x == 1 || x == number - 1) {
+            continue;
+        }
+        bool composite = true;
+        for (int i = 1; i < twos && composite; ++i) {
+            x = mulMod<Product>(x, x, number);
+            composite = x != number - 1;
+        }
+        if (composite) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isPrime32(std::uint32_t number) {
+    return millerRabin<std::uint64_t>(number, WITNESSES_32);
+}
+
+bool isPrime64(std::uint64_t number) {
+    if (number <= UINT32_MAX) {
+        return millerRabin<std::uint64_t>(number, WITNESSES_32);
+    }
+    return millerRabin<unsigned __int128>(number, WITNESSES_64);
+}
+
+
+// Odd values sieved per segment: 2^18 bits is 32KB, small enough to stay in L1/L2 while marking
+static const std::int64_t SEGMENT_ODDS = 1 << 18;
+
+static const std::int64_t WORD_BITS = 64;
+
+void PrimalityOracle::cover(std::int64_t min, std::int64_t max) {
+    low = (std::max<std::int64_t>(min, 2) - 1) | 1;  // round down to odd, skip everything below 1
+    high = std::max(max + 1, low);
+    auto odds = (high - low + 1) / 2;
+    compositeBits.assign(static_cast<std::size_t>((odds + WORD_BITS - 1) / WORD_BITS), 0);
+
+    // Odd base primes up to sqrt(high) from a plain sieve
+    std::int64_t root = 1;
+    while (root * root < high) {
+        ++root;
+    }
+    std::vector<bool> baseComposite(static_cast<std::size_t>(root + 1), false);
+    std::vector<std::int64_t> basePrimes;
+    for (std::int64_t i = 3; i <= root; i += 2) {
+        if (!baseComposite[static_cast<std::size_t>(i)]) {
+            basePrimes.push_back(i);
+            for (std::int64_t j = i * i; j <= root; j += 2 * i) {
+                baseComposite[static_cast<std::size_t>(j)] = true;
+            }
+        }
+    }
+
+    for (std::int64_t segmentLow = low; segmentLow < high; segmentLow += 2 * SEGMENT_ODDS) {
+        sieveSegment(basePrimes, segmentLow, std::min(segmentLow + 2 * SEGMENT_ODDS, high));
+    }
+    if (low == 1 && !compositeBits.empty()) {
+        compositeBits[0] |= 1U;
+    }
+}
+
+void PrimalityOracle::sieveSegment(const std::vector<std::int64_t> &basePrimes, std::int64_t segmentLow,
+                                   std::int64_t segmentHigh) {
+    for (std::int64_t prime: basePrimes) {
+        if (prime * prime >= segmentHigh) {
+            break;
+        }
+        // First odd multiple of prime inside the segment, never below prime^2
+        std::int64_t first = std::max(prime * prime, (segmentLow + prime - 1) / prime * prime);
+        if ((first & 1) == 0) {
+            first += prime;
+        }
+        for (std::int64_t multiple = first; multiple < segmentHigh; multiple += 2 * prime) {
+            auto bit = static_cast<std::uint64_t>((multiple - low) / 2);
+            compositeBits[bit / WORD_BITS] |= std::uint64_t{1} << (bit % WORD_BITS);
+        }
+    }
+}
+
+bool PrimalityOracle::covers(std::int64_t min, std::int64_t max) const {
+    return std::max<std::int64_t>(min, 2) >= low && max < high;
+}
+
+bool PrimalityOracle::isPrime(std::int64_t number) const {
+    if (number < low || number >= high) {
+        return number >= 2 && isPrime64(static_cast<std::uint64_t>(number));
+    }
+    if ((number & 1) == 0) {
+        return number == 2;
+    }
+    auto bit = static_cast<std::uint64_t>((number - low) / 2);
+    return ((compositeBits[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1U) == 0;
+}
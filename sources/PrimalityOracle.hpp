@@ -0,0 +1,31 @@
+#ifndef PRIMALITYORACLE_H
+#define PRIMALITYORACLE_H
+
+#include <vector>
+#include <cstdint>
+
+// Deterministic Miller-Rabin with small-prime pre-filtering, exact over the whole argument range
+[[nodiscard]] bool isPrime32(std::uint32_t number);
+
+[[nodiscard]] bool isPrime64(std::uint64_t number);
+
+// Answers primality with a single bit lookup for values inside a sieved window and falls back to
+// Miller-Rabin for everything outside it. The window holds odd numbers only.
+class PrimalityOracle {
+private:
+    std::int64_t low = 0;   // first odd value covered by the sieve
+    std::int64_t high = 0;  // one past the last value covered by the sieve
+    std::vector<std::uint64_t> compositeBits;  // bit i is set when low + 2 * i is not prime
+
+    void sieveSegment(const std::vector<std::int64_t> &basePrimes, std::int64_t segmentLow, std::int64_t segmentHigh);
+
+public:
+    // Rebuilds the sieve so it covers every value in [min, max]
+    void cover(std::int64_t min, std::int64_t max);
+
+    [[nodiscard]] bool covers(std::int64_t min, std::int64_t max) const;
+
+    [[nodiscard]] bool isPrime(std::int64_t number) const;
+};
+
+#endif  // PRIMALITYORACLE_H
@@ -0,0 +1,35 @@
+#include "SnapshotMagicalContainer.hpp"
+
+template<typename T>
+void SnapshotMagicalContainer<T>::addElement(T element) {
+    update([element](BasicMagicalContainer<T> &next) { next.addElement(element); });
+}
+
+template<typename T>
+void SnapshotMagicalContainer<T>::addElements(std::vector<T> batch) {
+    update([&batch](BasicMagicalContainer<T> &next) { next.addElements(std::move(batch)); });
+}
+
+template<typename T>
+void SnapshotMagicalContainer<T>::removeElement(T element) {
+    update([element](BasicMagicalContainer<T> &next) { next.removeElement(element); });
+}
+
+template<typename T>
+void SnapshotMagicalContainer<T>::removeElements(std::vector<T> victims) {
+    update([&victims](BasicMagicalContainer<T> &next) { next.removeElements(std::move(victims)); });
+}
+
+template<typename T>
+int SnapshotMagicalContainer<T>::size() const {
+    return current.load()->size();
+}
+
+template<typename T>
+typename SnapshotMagicalContainer<T>::Snapshot SnapshotMagicalContainer<T>::snapshot() const {
+    return current.load();
+}
+
+template class SnapshotMagicalContainer<std::int32_t>;
+template class SnapshotMagicalContainer<std::int64_t>;
+template class SnapshotMagicalContainer<std::uint64_t>;
@@ -0,0 +1,75 @@
+#ifndef SNAPSHOTMAGICALCONTAINER_H
+#define SNAPSHOTMAGICALCONTAINER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "MagicalContainer.hpp"
+
+// Copy-on-write container for read-mostly workloads. The current contents are an immutable
+// BasicMagicalContainer published through an atomic shared_ptr: readers pin it with one atomic load and
+// take no reader-writer mutex, while writers copy it, apply their change and publish the copy with one O(1)
+// store. A reader never waits for a writer's copy, but the atomic shared_ptr is not lock-free (libstdc++
+// guards load and store with a shared spinlock), so it may briefly spin behind a publish. A snapshot is
+// freed when the last reader pinning it lets go, so iterators stay valid for as long as the pin is held.
+// Every publish copies the whole container; batch mutations through update() to pay that once.
+template<typename T>
+class SnapshotMagicalContainer {
+public:
+    using Snapshot = std::shared_ptr<const BasicMagicalContainer<T>>;
+
+private:
+    std::atomic<Snapshot> current{std::make_shared<const BasicMagicalContainer<T>>()};
+    std::mutex writeLock;  // serializes writers so no update is lost between copy and publish
+
+public:
+    using value_type = T;
+
+    void addElement(T element);
+
+    void addElements(std::vector<T> batch);
+
+    template<typename InputIt>
+    void addElements(InputIt first, InputIt last) {
+        addElements(std::vector<T>(first, last));
+    }
+
+    void removeElement(T element);
+
+    void removeElements(std::vector<T> victims);
+
+    template<typename InputIt>
+    void removeElements(InputIt first, InputIt last) {
+        removeElements(std::vector<T>(first, last));
+    }
+
+    // Applies mutator(BasicMagicalContainer<T> &) to a private copy and publishes it as one snapshot
+    template<typename Mutator>
+    void update(Mutator mutator) {
+        std::lock_guard<std::mutex> guard(writeLock);
+        auto next = std::make_shared<BasicMagicalContainer<T>>(*current.load());
+        mutator(*next);
+        // Readers share the snapshot, so it must not hold buffered inserts that a read would merge
+        next->flush();
+        current.store(std::move(next));
+    }
+
+    [[nodiscard]] int size() const;
+
+    // Pins the current contents; iterators over *snapshot() stay valid while the pointer is alive
+    [[nodiscard]] Snapshot snapshot() const;
+
+    // Calls reader(const BasicMagicalContainer<T> &) on a pinned snapshot and returns its result
+    template<typename Reader>
+    auto read(Reader reader) const {
+        Snapshot pinned = snapshot();
+        return reader(*pinned);
+    }
+};
+
+extern template class SnapshotMagicalContainer<std::int32_t>;
+extern template class SnapshotMagicalContainer<std::int64_t>;
+extern template class SnapshotMagicalContainer<std::uint64_t>;
+
+#endif  // SNAPSHOTMAGICALCONTAINER_H
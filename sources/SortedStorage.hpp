@@ -0,0 +1,1038 @@
+#ifndef SORTEDSTORAGE_H
+#define SORTEDSTORAGE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Storage backends for MagicalContainer. All three keep a multiset of values in ascending order behind the
+// same small interface: indexed reads plus sorted insert/erase/merge/remove, each mutation returning the
+// number of values it had to move.
+
+// Merges an already sorted batch into a sorted vector: grow once, then fill from the back
+// so every element moves exactly one time. Returns the number of elements written.
+template<typename Vector, typename Batch>
+std::size_t mergeSorted(Vector &into, const Batch &sortedBatch) {
+    auto oldSize = into.size();
+    into.resize(oldSize + sortedBatch.size());
+    auto write = into.end();
+    auto readOld = into.begin() + static_cast<std::ptrdiff_t>(oldSize);
+    auto readBatch = sortedBatch.end();
+    while (readBatch != sortedBatch.begin()) {
+        if (readOld != into.begin() && *(readOld - 1) > *(readBatch - 1)) {
+            *--write = *--readOld;
+        } else {
+            *--write = *--readBatch;
+        }
+    }
+    return static_cast<std::size_t>(into.end() - write);
+}
+
+// Walks both sorted sequences together and keeps only the values that are not victims. victim is left at
+// the first victim not below the last kept value, so consecutive sorted runs can share one victim cursor.
+// Returns the number of kept elements that had to shift down.
+template<typename Vector, typename VictimIt>
+std::size_t removeSorted(Vector &from, VictimIt &victim, VictimIt victimsEnd) {
+    std::size_t moves = 0;
+    auto write = from.begin();
+    for (auto read = from.begin(); read != from.end(); ++read) {
+        while (victim != victimsEnd && *victim < *read) {
+            ++victim;
+        }
+        if (victim == victimsEnd || *victim != *read) {
+            moves += write != read ? 1U : 0U;
+            *write++ = *read;
+        }
+    }
+    from.erase(write, from.end());
+    return moves;
+}
+
+template<typename Vector, typename Victims>
+std::size_t removeSorted(Vector &from, const Victims &sortedVictims) {
+    auto victim = sortedVictims.begin();
+    return removeSorted(from, victim, sortedVictims.end());
+}
+
+// Below this many candidates the search finishes with a plain count, which compiles to SIMD compares
+const std::size_t FINAL_SEARCH_BLOCK = 16;
+
+// Number of values in the sorted run [data, data + count) that are below value, or with OrEqual that are
+// not above it. The halving loop has a fixed trip count and its compare becomes a conditional move, so it
+// never mispredicts; both possible next probes are prefetched while the current one resolves.
+template<bool OrEqual = false, typename T>
+std::size_t branchlessRank(const T *data, std::size_t count, T value) {
+    auto before = [value](T candidate) { return OrEqual ? !(value < candidate) : candidate < value; };
+    const T *base = data;
+    while (count > FINAL_SEARCH_BLOCK) {
+        std::size_t half = count / 2;
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+        base = before(base[half]) ? base + half : base;
+        count -= half;
+    }
+    std::size_t below = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        below += before(base[i]) ? 1U : 0U;
+    }
+    return static_cast<std::size_t>(base - data) + below;
+}
+
+// One contiguous vector: fastest scans, but a mid-sequence insert or erase shifts the whole tail. It can
+// also serve a sorted run it does not own, such as a mapped file, until the first mutation copies it in.
+// With InlineCapacity > 0 the first values live in an array inside the object and are kept sorted by
+// insertion, so a container that never outgrows it never allocates; the first value past it moves
+// everything to the heap for good.
+template<typename T, typename Allocator = std::allocator<T>, std::size_t InlineCapacity = 0>
+class SortedVector {
+private:
+    std::array<T, InlineCapacity> inlineValues{};
+    std::vector<T, Allocator> values;
+    // What reads see: the inline array, values' buffer, or a borrowed run kept alive by keepAlive
+    const T *first = inlineValues.data();
+    std::size_t count = 0;
+    std::shared_ptr<const void> keepAlive;
+
+    [[nodiscard]] bool isInline() const { return InlineCapacity > 0 && first == inlineValues.data(); }
+
+    void refresh() {
+        first = values.data();
+        count = values.size();
+    }
+
+    // Back to an empty inline array, for moved-from objects
+    void reset() {
+        values.clear();
+        keepAlive.reset();
+        first = InlineCapacity > 0 ? inlineValues.data() : values.data();
+        count = 0;
+    }
+
+    // Points the reads at this object's copy of other's contents; values and keepAlive are already taken
+    void takeFrom(const SortedVector &other) {
+        if (other.isInline()) {
+            std::copy_n(other.inlineValues.begin(), other.count, inlineValues.begin());
+            first = inlineValues.data();
+            count = other.count;
+        } else {
+            first = keepAlive ? other.first : values.data();
+            count = other.count;
+        }
+    }
+
+    // Copies a borrowed run or the inline array into values before a write that needs the heap
+    void own() {
+        if (keepAlive || isInline()) {
+            values.reserve(std::max(count + 1, 2 * InlineCapacity));
+            values.assign(first, first + count);
+            keepAlive.reset();
+        }
+    }
+
+    // Insertion into the inline array, shifting only the larger values; false when it is full or unused
+    bool insertInline(T value, std::size_t &moves) {
+        if (!isInline() || count == InlineCapacity) {
+            return false;
+        }
+        std::size_t slot = count;
+        for (; slot > 0 && value < inlineValues[slot - 1]; --slot) {
+            inlineValues[slot] = inlineValues[slot - 1];
+        }
+        inlineValues[slot] = value;
+        moves += count++ - slot;
+        return true;
+    }
+
+public:
+    // Whether forEachRun's runs stay valid after the call returns
+    static constexpr bool STABLE_RUNS = true;
+
+    SortedVector() = default;
+
+    explicit SortedVector(const Allocator &allocator) : values(allocator) {}
+
+    SortedVector(const SortedVector &other) : values(other.values), keepAlive(other.keepAlive) { takeFrom(other); }
+
+    SortedVector(SortedVector &&other) noexcept
+            : values(std::move(other.values)), keepAlive(std::move(other.keepAlive)) {
+        takeFrom(other);
+        other.reset();
+    }
+
+    SortedVector &operator=(const SortedVector &other) {
+        if (this != &other) {
+            *this = SortedVector(other);
+        }
+        return *this;
+    }
+
+    SortedVector &operator=(SortedVector &&other) noexcept {
+        values = std::move(other.values);
+        keepAlive = std::move(other.keepAlive);
+        takeFrom(other);
+        other.reset();
+        return *this;
+    }
+
+    ~SortedVector() = default;
+
+    // Serves [data, data + size) in place while keepAlive holds its owner
+    void assignView(const T *data, std::size_t size, std::shared_ptr<const void> owner) {
+        values.clear();
+        values.shrink_to_fit();
+        first = data;
+        count = size;
+        keepAlive = std::move(owner);
+    }
+
+    [[nodiscard]] std::size_t size() const { return count; }
+
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    [[nodiscard]] const T &operator[](std::size_t index) const { return first[index]; }
+
+    [[nodiscard]] const T &front() const { return first[0]; }
+
+    [[nodiscard]] const T &back() const { return first[count - 1]; }
+
+    // Index of the first value not below value
+    [[nodiscard]] std::size_t lowerBound(T value) const { return branchlessRank(first, count, value); }
+
+    // Index of the first value above value
+    [[nodiscard]] std::size_t upperBound(T value) const { return branchlessRank<true>(first, count, value); }
+
+    // Inserts after any equal values
+    std::size_t insert(T value) {
+        std::size_t moves = 0;
+        if (insertInline(value, moves)) {
+            return moves;
+        }
+        own();
+        auto slot = std::upper_bound(values.begin(), values.end(), value);
+        moves = static_cast<std::size_t>(values.end() - slot);
+        values.insert(slot, value);
+        refresh();
+        return moves;
+    }
+
+    // Erases every copy of value
+    std::size_t erase(T value) {
+        if (isInline()) {
+            auto *begin = inlineValues.data();
+            auto range = std::equal_range(begin, begin + count, value);
+            auto moves = static_cast<std::size_t>(begin + count - range.second);
+            std::copy(range.second, begin + count, range.first);
+            count -= static_cast<std::size_t>(range.second - range.first);
+            return moves;
+        }
+        own();
+        auto range = std::equal_range(values.begin(), values.end(), value);
+        auto moves = static_cast<std::size_t>(values.end() - range.second);
+        values.erase(range.first, range.second);
+        refresh();
+        return moves;
+    }
+
+    template<typename Batch>
+    std::size_t merge(const Batch &sortedBatch) {
+        if (isInline() && count + sortedBatch.size() <= InlineCapacity) {
+            std::size_t moves = 0;
+            for (T value: sortedBatch) {
+                insertInline(value, moves);
+            }
+            return moves;
+        }
+        own();
+        auto moves = mergeSorted(values, sortedBatch);
+        refresh();
+        return moves;
+    }
+
+    void appendTo(std::vector<T> &out) const { out.insert(out.end(), first, first + count); }
+
+    // Calls visit(const T *, std::size_t) on each contiguous run in order
+    template<typename Visitor>
+    void forEachRun(Visitor visit) const {
+        visit(first, count);
+    }
+
+    // Same, limited to the values at [from, from + length), with the first and last runs trimmed to fit
+    template<typename Visitor>
+    void forEachRun(std::size_t from, std::size_t length, Visitor visit) const {
+        if (from < count) {
+            visit(first + from, std::min(length, count - from));
+        }
+    }
+
+    template<typename Victims>
+    std::size_t remove(const Victims &sortedVictims) {
+        if (isInline()) {
+            auto *begin = inlineValues.data();
+            std::size_t moves = 0;
+            std::size_t kept = 0;
+            auto victim = sortedVictims.begin();
+            for (std::size_t read = 0; read < count; ++read) {
+                while (victim != sortedVictims.end() && *victim < begin[read]) {
+                    ++victim;
+                }
+                if (victim == sortedVictims.end() || *victim != begin[read]) {
+                    moves += kept != read ? 1U : 0U;
+                    begin[kept++] = begin[read];
+                }
+            }
+            count = kept;
+            return moves;
+        }
+        own();
+        auto moves = removeSorted(values, sortedVictims);
+        refresh();
+        return moves;
+    }
+};
+
+// Sorted run of blocks of at most BLOCK_BYTES each. An insert or erase shifts one block plus the block
+// start table instead of the whole tail, so a mid-sequence update at 10^7 ints moves a few thousand
+// values rather than millions. Scans stay sequential within each block, and indexed reads remember the
+// last block they hit so ascending traversal resolves almost every index without a search. Removals fold
+// a block that drops below a quarter full into its neighbour, so heavy erasing cannot leave a long tail
+// of nearly empty blocks behind.
+template<typename T, typename Allocator = std::allocator<T>>
+class SortedBlocks {
+private:
+    static constexpr std::size_t BLOCK_BYTES = 16384;
+    static constexpr std::size_t BLOCK_CAPACITY = BLOCK_BYTES / sizeof(T);
+    static constexpr std::size_t MIN_BLOCK_FILL = BLOCK_CAPACITY / 4;
+
+    using Block = std::vector<T, Allocator>;
+    template<typename U>
+    using Rebound = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+    // New blocks get their allocator through uses-allocator construction, so pmr resources reach them too
+    std::vector<Block, Rebound<Block>> blocks;  // non-empty, sorted, and ordered by their values
+    // starts[i] is the index of blocks[i].front(); the last entry is size()
+    std::vector<std::size_t, Rebound<std::size_t>> starts;
+    // Block of the previous indexed read; relaxed because it is only a hint and readers may share it
+    mutable std::atomic<std::size_t> lastBlock{0};
+
+    void renumberFrom(std::size_t block) {
+        starts.resize(blocks.size() + 1);
+        for (std::size_t i = block; i < blocks.size(); ++i) {
+            starts[i + 1] = starts[i] + blocks[i].size();
+        }
+    }
+
+    [[nodiscard]] Allocator allocator() const { return Allocator(blocks.get_allocator()); }
+
+    // Re-cuts a sorted run into full blocks
+    void rebuild(const Block &sorted) {
+        blocks.clear();
+        for (std::size_t first = 0; first < sorted.size(); first += BLOCK_CAPACITY) {
+            auto last = std::min(first + BLOCK_CAPACITY, sorted.size());
+            blocks.emplace_back(sorted.begin() + static_cast<std::ptrdiff_t>(first),
+                                sorted.begin() + static_cast<std::ptrdiff_t>(last));
+        }
+        starts.assign(1, 0);
+        renumberFrom(0);
+    }
+
+    [[nodiscard]] Block flatten() const {
+        Block sorted(allocator());
+        sorted.reserve(size());
+        for (const Block &block: blocks) {
+            sorted.insert(sorted.end(), block.begin(), block.end());
+        }
+        return sorted;
+    }
+
+    // Folds each underfull block in [first, last] into a neighbour, and splits the pair evenly again when
+    // together they overflow. Leaves starts stale from the first block it touched; returns the values moved.
+    std::size_t compact(std::size_t first, std::size_t last) {
+        std::size_t moves = 0;
+        std::size_t block = first;
+        while (block <= last && block < blocks.size() && blocks.size() > 1) {
+            if (blocks[block].size() >= MIN_BLOCK_FILL) {
+                ++block;
+                continue;
+            }
+            std::size_t lower = block + 1 < blocks.size() ? block : block - 1;
+            Block &into = blocks[lower];
+            Block &from = blocks[lower + 1];
+            moves += from.size();
+            into.insert(into.end(), from.begin(), from.end());
+            if (into.size() > BLOCK_CAPACITY) {
+                auto half = static_cast<std::ptrdiff_t>(into.size() / 2);
+                from.assign(into.begin() + half, into.end());
+                into.resize(static_cast<std::size_t>(half));
+                moves += from.size();
+                block = lower + 2;
+            } else {
+                blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(lower) + 1);
+                last = last > 0 ? last - 1 : 0;
+                block = lower;
+            }
+        }
+        return moves;
+    }
+
+    [[nodiscard]] std::size_t blockOf(std::size_t index) const {
+        auto block = lastBlock.load(std::memory_order_relaxed);
+        if (block < blocks.size() && index >= starts[block] && index < starts[block + 1]) {
+            return block;
+        }
+        if (block + 1 < blocks.size() && index >= starts[block + 1] && index < starts[block + 2]) {
+            ++block;
+        } else {
+            block = static_cast<std::size_t>(std::upper_bound(starts.begin(), starts.end(), index) - starts.begin()) - 1;
+        }
+        lastBlock.store(block, std::memory_order_relaxed);
+        return block;
+    }
+
+public:
+    static constexpr bool STABLE_RUNS = true;
+
+    SortedBlocks() : SortedBlocks(Allocator()) {}
+
+    explicit SortedBlocks(const Allocator &allocator) : blocks(allocator), starts(1, 0, allocator) {}
+
+    SortedBlocks(const SortedBlocks &other) : blocks(other.blocks), starts(other.starts) {}
+
+    SortedBlocks(SortedBlocks &&other) noexcept : blocks(std::move(other.blocks)), starts(std::move(other.starts)) {
+        other.blocks.clear();
+        other.starts.assign(1, 0);
+    }
+
+    SortedBlocks &operator=(const SortedBlocks &other) {
+        blocks = other.blocks;
+        starts = other.starts;
+        lastBlock.store(0, std::memory_order_relaxed);
+        return *this;
+    }
+
+    SortedBlocks &operator=(SortedBlocks &&other) noexcept {
+        blocks = std::move(other.blocks);
+        starts = std::move(other.starts);
+        other.blocks.clear();
+        other.starts.assign(1, 0);
+        lastBlock.store(0, std::memory_order_relaxed);
+        return *this;
+    }
+
+    ~SortedBlocks() = default;
+
+    [[nodiscard]] std::size_t size() const { return starts.back(); }
+
+    [[nodiscard]] bool empty() const { return blocks.empty(); }
+
+    [[nodiscard]] std::size_t blockCount() const { return blocks.size(); }
+
+    [[nodiscard]] const T &operator[](std::size_t index) const {
+        auto block = blockOf(index);
+        return blocks[block][index - starts[block]];
+    }
+
+    [[nodiscard]] const T &front() const { return blocks.front().front(); }
+
+    [[nodiscard]] const T &back() const { return blocks.back().back(); }
+
+    // The first block whose last value is not below (or with OrEqual, is above) value holds the answer
+    template<bool OrEqual = false>
+    [[nodiscard]] std::size_t rank(T value) const {
+        auto block = static_cast<std::size_t>(
+                std::partition_point(blocks.begin(), blocks.end(), [value](const Block &values) {
+                    return OrEqual ? !(value < values.back()) : values.back() < value;
+                }) - blocks.begin());
+        if (block == blocks.size()) {
+            return size();
+        }
+        const Block &values = blocks[block];
+        return starts[block] + branchlessRank<OrEqual>(values.data(), values.size(), value);
+    }
+
+    [[nodiscard]] std::size_t lowerBound(T value) const { return rank(value); }
+
+    [[nodiscard]] std::size_t upperBound(T value) const { return rank<true>(value); }
+
+    // Inserts after any equal values, splitting the target block in half once it overflows
+    std::size_t insert(T value) {
+        if (blocks.empty()) {
+            blocks.emplace_back(1, value);
+            renumberFrom(0);
+            return 0;
+        }
+        auto target = std::upper_bound(blocks.begin(), blocks.end() - 1, value,
+                                       [](T lhs, const Block &block) { return lhs < block.back(); });
+        auto block = static_cast<std::size_t>(target - blocks.begin());
+        Block &values = blocks[block];
+        auto slot = std::upper_bound(values.begin(), values.end(), value);
+        auto moves = static_cast<std::size_t>(values.end() - slot);
+        values.insert(slot, value);
+        if (values.size() > BLOCK_CAPACITY) {
+            Block upper(values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2), values.end(),
+                        values.get_allocator());
+            values.resize(values.size() / 2);
+            blocks.insert(blocks.begin() + static_cast<std::ptrdiff_t>(block) + 1, std::move(upper));
+            moves += BLOCK_CAPACITY / 2;
+        }
+        renumberFrom(block);
+        return moves;
+    }
+
+    // Erases every copy of value, which may span several blocks
+    std::size_t erase(T value) {
+        auto first = static_cast<std::size_t>(
+                std::lower_bound(blocks.begin(), blocks.end(), value,
+                                 [](const Block &block, T rhs) { return block.back() < rhs; }) -
+                blocks.begin());
+        std::size_t moves = 0;
+        std::size_t block = first;
+        while (block < blocks.size() && blocks[block].front() <= value) {
+            Block &values = blocks[block];
+            auto range = std::equal_range(values.begin(), values.end(), value);
+            moves += static_cast<std::size_t>(values.end() - range.second);
+            values.erase(range.first, range.second);
+            if (values.empty()) {
+                blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(block));
+            } else {
+                ++block;
+            }
+        }
+        // The blocks at either end of the erased run are the only ones that can have shrunk
+        moves += compact(first, block);
+        renumberFrom(std::min(first > 0 ? first - 1 : 0, blocks.size()));
+        return moves;
+    }
+
+    // Blocks are cut from their own storage, so a borrowed run is copied once and owner is not retained
+    void assignView(const T *data, std::size_t size, const std::shared_ptr<const void> & /* owner */) {
+        rebuild(Block(data, data + size, allocator()));
+        lastBlock.store(0, std::memory_order_relaxed);
+    }
+
+    template<typename Visitor>
+    void forEachRun(Visitor visit) const {
+        for (const Block &block: blocks) {
+            visit(block.data(), block.size());
+        }
+    }
+
+    // Starts at the block holding from, so skipping ahead costs one search rather than a walk
+    template<typename Visitor>
+    void forEachRun(std::size_t from, std::size_t length, Visitor visit) const {
+        std::size_t end = from + std::min(length, size() - std::min(from, size()));
+        for (std::size_t block = from < end ? blockOf(from) : blocks.size(); from < end; ++block) {
+            std::size_t offset = from - starts[block];
+            std::size_t take = std::min(blocks[block].size() - offset, end - from);
+            visit(blocks[block].data() + offset, take);
+            from += take;
+        }
+    }
+
+    void appendTo(std::vector<T> &out) const {
+        out.reserve(out.size() + size());
+        for (const Block &block: blocks) {
+            out.insert(out.end(), block.begin(), block.end());
+        }
+    }
+
+    // Small batches go in value by value; larger ones are merged into one run and re-cut, touching every value once
+    template<typename Batch>
+    std::size_t merge(const Batch &sortedBatch) {
+        if (sortedBatch.size() < blocks.size()) {
+            std::size_t moves = 0;
+            for (T value: sortedBatch) {
+                moves += insert(value);
+            }
+            return moves;
+        }
+        Block sorted = flatten();
+        auto moves = mergeSorted(sorted, sortedBatch);
+        rebuild(sorted);
+        return moves;
+    }
+
+    template<typename Victims>
+    std::size_t remove(const Victims &sortedVictims) {
+        std::size_t moves = 0;
+        auto victim = sortedVictims.begin();
+        for (Block &block: blocks) {
+            moves += removeSorted(block, victim, sortedVictims.end());
+        }
+        blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+                                    [](const Block &block) { return block.empty(); }), blocks.end());
+        moves += compact(0, blocks.size());
+        renumberFrom(0);
+        return moves;
+    }
+};
+
+// Sorted run compressed into frame-of-reference blocks of up to BLOCK_VALUES values: each block keeps its
+// first value as is and bit-packs the gaps to the rest at the width of its largest gap, so a dense run
+// costs a few bits per value instead of sizeof(T) bytes. Reads decode a whole block into a per-thread cache
+// holding the last two blocks, so an ascending scan decodes every block once and the cross order, which
+// alternates between the two ends, keeps one block for each end. The runs forEachRun hands out are those
+// decoded copies and only live for the call. Updates re-pack the blocks they touch and splice the packed
+// words behind them, which is still a tail move, only a compressed one; batch them.
+template<typename T, typename Allocator = std::allocator<T>>
+class SortedPacked {
+private:
+    static constexpr std::size_t BLOCK_VALUES = 128;
+
+    using Unsigned = std::make_unsigned_t<T>;
+    template<typename U>
+    using Rebound = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+    using Run = std::vector<T, Allocator>;
+
+    struct Block {
+        std::size_t start;       // index of the block's first value
+        std::size_t wordOffset;  // where its gaps begin in words
+        T base;                  // its first value
+        std::uint8_t width;      // bits per gap
+    };
+
+    // A block as the reads see it, tagged with the version of the contents it was decoded from
+    struct Decoded {
+        std::uint64_t version = 0;
+        std::size_t start = 0;
+        std::size_t count = 0;
+        std::array<T, BLOCK_VALUES> values{};
+    };
+
+    std::vector<Block, Rebound<Block>> blocks;
+    // Gaps of every block back to back, each block starting on a fresh word, plus one spare zero word at the
+    // end so decoding can always read a word past the one it needs; empty while there are no blocks
+    std::vector<std::uint64_t, Rebound<std::uint64_t>> words;
+    std::size_t count = 0;
+    // Names these contents in the decode cache. Every change takes a fresh one, so a cached block can never
+    // be mistaken for one of a later version or of another object; a copy shares its source's contents and
+    // so may share its version too.
+    std::uint64_t version = 0;
+
+    static inline std::atomic<std::uint64_t> nextVersion{1};
+    // Per thread, so concurrent readers never share a buffer; recent is the entry used last
+    static inline thread_local std::array<Decoded, 2> cache{};
+    static inline thread_local std::size_t recent = 0;
+
+    [[nodiscard]] Allocator allocator() const { return Allocator(blocks.get_allocator()); }
+
+    [[nodiscard]] std::size_t countOf(std::size_t block) const {
+        return (block + 1 < blocks.size() ? blocks[block + 1].start : count) - blocks[block].start;
+    }
+
+    [[nodiscard]] std::size_t blockOf(std::size_t index) const {
+        return static_cast<std::size_t>(std::partition_point(blocks.begin(), blocks.end(), [index](const Block &block) {
+            return block.start <= index;
+        }) - blocks.begin()) - 1;
+    }
+
+    // Unpacks count gaps of Width bits. With the width a constant, so are the mask and the shift pattern,
+    // and the loop has no branches and no carried dependency
+    template<std::size_t Width>
+    static void unpack(const std::uint64_t *packed, std::size_t count, Unsigned *gaps) {
+        constexpr std::uint64_t mask = Width == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << Width) - 1;
+        for (std::size_t i = 0; i < count; ++i) {
+            std::size_t bit = i * Width;
+            std::size_t word = bit / 64;
+            std::size_t shift = bit % 64;
+            gaps[i] = static_cast<Unsigned>(((packed[word] >> shift) | (packed[word + 1] << 1 << (63 - shift))) & mask);
+        }
+    }
+
+    using Unpacker = void (*)(const std::uint64_t *, std::size_t, Unsigned *);
+
+    template<std::size_t... Widths>
+    static constexpr std::array<Unpacker, sizeof...(Widths)> unpackers(std::index_sequence<Widths...>) {
+        return {&unpack<Widths>...};
+    }
+
+    // unpack<w> for every width a gap of T can need, 1 through the bits of T; width 0 never unpacks
+    static constexpr auto UNPACKERS = unpackers(std::make_index_sequence<sizeof(T) * 8 + 1>());
+
+    // Unpacks the gaps, then adds them up from the base
+    void decode(std::size_t block, T *out) const {
+        const Block &header = blocks[block];
+        std::size_t values = countOf(block);
+        if (header.width == 0) {
+            // A run of equal values owns no words, so there may be no word behind it to read
+            std::fill_n(out, values, header.base);
+            return;
+        }
+        Unsigned gaps[BLOCK_VALUES];
+        UNPACKERS[header.width](words.data() + header.wordOffset, values - 1, gaps);
+        auto value = static_cast<Unsigned>(header.base);
+        out[0] = header.base;
+        for (std::size_t i = 1; i < values; ++i) {
+            value = static_cast<Unsigned>(value + gaps[i - 1]);
+            out[i] = static_cast<T>(value);
+        }
+    }
+
+    // Bits per gap for the sorted run [data, data + size): the width of its largest gap
+    static std::size_t widthOf(const T *data, std::size_t size) {
+        Unsigned widest = 0;
+        for (std::size_t i = 1; i < size; ++i) {
+            widest |= static_cast<Unsigned>(static_cast<Unsigned>(data[i]) - static_cast<Unsigned>(data[i - 1]));
+        }
+        return static_cast<std::size_t>(std::bit_width(widest));
+    }
+
+    static std::size_t wordsFor(std::size_t size, std::size_t width) { return ((size - 1) * width + 63) / 64; }
+
+    // Ors the gaps of [data, data + size) into the zeroed words at out
+    static void pack(const T *data, std::size_t size, std::size_t width, std::uint64_t *out) {
+        for (std::size_t i = 1; i < size && width > 0; ++i) {
+            auto gap = static_cast<std::uint64_t>(
+                    static_cast<Unsigned>(static_cast<Unsigned>(data[i]) - static_cast<Unsigned>(data[i - 1])));
+            std::size_t bit = (i - 1) * width;
+            std::size_t shift = bit % 64;
+            out[bit / 64] |= gap << shift;
+            if (shift + width > 64) {
+                out[bit / 64 + 1] |= gap >> (64 - shift);
+            }
+        }
+    }
+
+    // Grows or shrinks [at, at + oldLength) of vector to newLength entries, moving what follows
+    template<typename Vector>
+    static void resizeRange(Vector &vector, std::size_t at, std::size_t oldLength, std::size_t newLength) {
+        auto end = vector.begin() + static_cast<std::ptrdiff_t>(at + oldLength);
+        if (newLength > oldLength) {
+            vector.insert(end, newLength - oldLength, typename Vector::value_type{});
+        } else {
+            vector.erase(vector.begin() + static_cast<std::ptrdiff_t>(at + newLength), end);
+        }
+    }
+
+    [[gnu::noinline]] const Decoded &fill(std::size_t block) const {
+        recent ^= 1U;
+        Decoded &entry = cache[recent];
+        decode(block, entry.values.data());
+        entry.version = version;
+        entry.start = blocks[block].start;
+        entry.count = countOf(block);
+        return entry;
+    }
+
+    [[nodiscard]] const Decoded &decodedAt(std::size_t index) const {
+        for (std::size_t i = 0; i < cache.size(); ++i) {
+            if (cache[i].version == version && index - cache[i].start < cache[i].count) {
+                recent = i;
+                return cache[i];
+            }
+        }
+        return fill(blockOf(index));
+    }
+
+    [[nodiscard]] const Decoded &decodedBlock(std::size_t block) const {
+        return decodedAt(blocks[block].start);
+    }
+
+    // Decodes blocks [first, last) into one sorted run
+    [[nodiscard]] Run decodeRange(std::size_t first, std::size_t last) const {
+        Run run(allocator());
+        std::size_t begin = first < blocks.size() ? blocks[first].start : count;
+        run.resize((last < blocks.size() ? blocks[last].start : count) - begin);
+        for (std::size_t block = first; block < last; ++block) {
+            decode(block, run.data() + (blocks[block].start - begin));
+        }
+        return run;
+    }
+
+    [[nodiscard]] std::size_t wordsBefore(std::size_t block) const {
+        return block < blocks.size() ? blocks[block].wordOffset : words.empty() ? 0 : words.size() - 1;
+    }
+
+    // Packs the sorted run [data, data + size) in place of blocks [first, last), cut into equal blocks of at
+    // most BLOCK_VALUES, and shifts the blocks behind them. Both tables are resized where they stand and
+    // packed into directly, so an update allocates nothing beyond their own growth.
+    void replace(std::size_t first, std::size_t last, const T *data, std::size_t size) {
+        std::size_t start = first < blocks.size() ? blocks[first].start : count;
+        std::size_t removed = (last < blocks.size() ? blocks[last].start : count) - start;
+        std::size_t wordBegin = wordsBefore(first);
+        std::size_t wordEnd = wordsBefore(last);
+        std::size_t pieces = (size + BLOCK_VALUES - 1) / BLOCK_VALUES;
+        auto pieceStart = [size, pieces](std::size_t piece) { return size * piece / pieces; };
+
+        std::size_t packedWords = 0;
+        for (std::size_t piece = 0; piece < pieces; ++piece) {
+            std::size_t from = pieceStart(piece);
+            std::size_t length = pieceStart(piece + 1) - from;
+            packedWords += wordsFor(length, widthOf(data + from, length));
+        }
+        if (words.empty()) {
+            words.push_back(0);
+        }
+        resizeRange(words, wordBegin, wordEnd - wordBegin, packedWords);
+        resizeRange(blocks, first, last - first, pieces);
+        std::fill_n(words.begin() + static_cast<std::ptrdiff_t>(wordBegin), packedWords, 0);
+
+        std::size_t wordOffset = wordBegin;
+        for (std::size_t piece = 0; piece < pieces; ++piece) {
+            std::size_t from = pieceStart(piece);
+            std::size_t length = pieceStart(piece + 1) - from;
+            std::size_t width = widthOf(data + from, length);
+            blocks[first + piece] = Block{start + from, wordOffset, data[from], static_cast<std::uint8_t>(width)};
+            pack(data + from, length, width, words.data() + wordOffset);
+            wordOffset += wordsFor(length, width);
+        }
+        // Unsigned wrap-around makes these shifts right whether the run grew or shrank
+        for (std::size_t block = first + pieces; block < blocks.size(); ++block) {
+            blocks[block].start += size - removed;
+            blocks[block].wordOffset += packedWords - (wordEnd - wordBegin);
+        }
+        count += size - removed;
+        if (blocks.empty()) {
+            words.clear();
+        }
+        version = nextVersion.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    static constexpr bool STABLE_RUNS = false;
+
+    SortedPacked() = default;
+
+    explicit SortedPacked(const Allocator &allocator) : blocks(allocator), words(allocator) {}
+
+    SortedPacked(const SortedPacked &other) = default;
+
+    SortedPacked(SortedPacked &&other) noexcept
+            : blocks(std::move(other.blocks)), words(std::move(other.words)), count(other.count), version(other.version) {
+        other.blocks.clear();
+        other.words.clear();
+        other.count = 0;
+        other.version = 0;
+    }
+
+    SortedPacked &operator=(const SortedPacked &other) = default;
+
+    SortedPacked &operator=(SortedPacked &&other) noexcept {
+        blocks = std::move(other.blocks);
+        words = std::move(other.words);
+        count = other.count;
+        version = other.version;
+        other.blocks.clear();
+        other.words.clear();
+        other.count = 0;
+        other.version = 0;
+        return *this;
+    }
+
+    ~SortedPacked() = default;
+
+    [[nodiscard]] std::size_t size() const { return count; }
+
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    [[nodiscard]] T operator[](std::size_t index) const {
+        const Decoded &block = decodedAt(index);
+        return block.values[index - block.start];
+    }
+
+    [[nodiscard]] T front() const { return blocks.front().base; }
+
+    [[nodiscard]] T back() const { return (*this)[count - 1]; }
+
+    // The last block starting below (or with OrEqual, not above) value holds the answer, unless none does
+    template<bool OrEqual = false>
+    [[nodiscard]] std::size_t rank(T value) const {
+        auto after = static_cast<std::size_t>(
+                std::partition_point(blocks.begin(), blocks.end(), [value](const Block &block) {
+                    return OrEqual ? !(value < block.base) : block.base < value;
+                }) - blocks.begin());
+        if (after == 0) {
+            return 0;
+        }
+        const Decoded &block = decodedBlock(after - 1);
+        return block.start + branchlessRank<OrEqual>(block.values.data(), block.count, value);
+    }
+
+    [[nodiscard]] std::size_t lowerBound(T value) const { return rank(value); }
+
+    [[nodiscard]] std::size_t upperBound(T value) const { return rank<true>(value); }
+
+    // Inserts after any equal values, splitting the target block in two once it overflows
+    std::size_t insert(T value) {
+        if (blocks.empty()) {
+            replace(0, 0, &value, 1);
+            return 0;
+        }
+        auto after = static_cast<std::size_t>(
+                std::partition_point(blocks.begin(), blocks.end(), [value](const Block &block) {
+                    return !(value < block.base);
+                }) - blocks.begin());
+        std::size_t block = after == 0 ? 0 : after - 1;
+        std::array<T, BLOCK_VALUES + 1> run;
+        std::size_t length = countOf(block);
+        decode(block, run.data());
+        auto *slot = std::upper_bound(run.data(), run.data() + length, value);
+        auto moves = static_cast<std::size_t>(run.data() + length - slot);
+        std::copy_backward(slot, run.data() + length, run.data() + length + 1);
+        *slot = value;
+        replace(block, block + 1, run.data(), length + 1);
+        return moves;
+    }
+
+    // Erases every copy of value, which may span several blocks
+    std::size_t erase(T value) {
+        std::size_t first = lowerBound(value);
+        std::size_t last = upperBound(value);
+        if (first == last) {
+            return 0;
+        }
+        std::size_t firstBlock = blockOf(first);
+        std::size_t lastBlock = blockOf(last - 1) + 1;
+        Run run = decodeRange(firstBlock, lastBlock);
+        auto begin = run.begin() + static_cast<std::ptrdiff_t>(first - blocks[firstBlock].start);
+        auto end = begin + static_cast<std::ptrdiff_t>(last - first);
+        auto moves = static_cast<std::size_t>(run.end() - end);
+        run.erase(begin, end);
+        replace(firstBlock, lastBlock, run.data(), run.size());
+        return moves;
+    }
+
+    // Packs its own copy, so owner is not retained
+    void assignView(const T *data, std::size_t size, const std::shared_ptr<const void> & /* owner */) {
+        replace(0, blocks.size(), data, size);
+    }
+
+    template<typename Visitor>
+    void forEachRun(Visitor visit) const {
+        std::array<T, BLOCK_VALUES> buffer;
+        for (std::size_t block = 0; block < blocks.size(); ++block) {
+            decode(block, buffer.data());
+            visit(static_cast<const T *>(buffer.data()), countOf(block));
+        }
+    }
+
+    // Decodes only the blocks overlapping [from, from + length), starting at the one holding from
+    template<typename Visitor>
+    void forEachRun(std::size_t from, std::size_t length, Visitor visit) const {
+        std::array<T, BLOCK_VALUES> buffer;
+        std::size_t end = from + std::min(length, count - std::min(from, count));
+        for (std::size_t block = from < end ? blockOf(from) : blocks.size(); from < end; ++block) {
+            decode(block, buffer.data());
+            std::size_t offset = from - blocks[block].start;
+            std::size_t take = std::min(countOf(block) - offset, end - from);
+            visit(static_cast<const T *>(buffer.data() + offset), take);
+            from += take;
+        }
+    }
+
+    void appendTo(std::vector<T> &out) const {
+        std::size_t offset = out.size();
+        out.resize(offset + count);
+        for (std::size_t block = 0; block < blocks.size(); ++block) {
+            decode(block, out.data() + offset + blocks[block].start);
+        }
+    }
+
+    // Small batches go in value by value; larger ones are merged into one run and re-packed, touching every value once
+    template<typename Batch>
+    std::size_t merge(const Batch &sortedBatch) {
+        if (sortedBatch.size() < blocks.size()) {
+            std::size_t moves = 0;
+            for (T value: sortedBatch) {
+                moves += insert(value);
+            }
+            return moves;
+        }
+        Run sorted = decodeRange(0, blocks.size());
+        auto moves = mergeSorted(sorted, sortedBatch);
+        replace(0, blocks.size(), sorted.data(), sorted.size());
+        return moves;
+    }
+
+    template<typename Victims>
+    std::size_t remove(const Victims &sortedVictims) {
+        Run sorted = decodeRange(0, blocks.size());
+        auto moves = removeSorted(sorted, sortedVictims);
+        if (sorted.size() != count) {
+            replace(0, blocks.size(), sorted.data(), sorted.size());
+        }
+        return moves;
+    }
+};
+
+// Read-only copy of a sorted run in Eytzinger (BFS) order: node k has children 2k and 2k + 1, so the top
+// levels of every search share a few cache lines and each step can prefetch a whole level ahead. Pays off
+// once the run no longer fits in cache; ranks map a node back to its index in the sorted run.
+template<typename T, typename Allocator = std::allocator<T>>
+class EytzingerIndex {
+private:
+    static constexpr std::size_t PER_CACHE_LINE = 64 / sizeof(T);
+
+    using RankAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::size_t>;
+
+    std::vector<T, Allocator> keys;  // keys[0] is unused so the root sits at 1; empty until the first build
+    // Full width, so runs past 2^32 values keep exact ranks; a search reads only one of them
+    std::vector<std::size_t, RankAllocator> ranks;
+
+    template<typename Storage>
+    void fill(const Storage &sorted, std::size_t &next, std::size_t node) {
+        if (node < keys.size()) {
+            fill(sorted, next, 2 * node);
+            keys[node] = sorted[next];
+            ranks[node] = next++;
+            fill(sorted, next, 2 * node + 1);
+        }
+    }
+
+    // Node holding the first key not below (or with OrEqual, above) value, or 0 if there is none
+    template<bool OrEqual>
+    [[nodiscard]] std::size_t search(T value) const {
+        std::size_t node = 1;
+        std::size_t count = size();
+        while (node <= count) {
+            __builtin_prefetch(keys.data() + std::min(node * PER_CACHE_LINE, count));
+            bool right = OrEqual ? !(value < keys[node]) : keys[node] < value;
+            node = 2 * node + (right ? 1U : 0U);
+        }
+        // Undo the trailing right turns; what is left is the first node the search went left at
+        return node >> static_cast<unsigned>(__builtin_ffsll(static_cast<long long>(~node)));
+    }
+
+    template<bool OrEqual>
+    [[nodiscard]] std::size_t rank(T value) const {
+        auto node = search<OrEqual>(value);
+        return node == 0 ? size() : ranks[node];
+    }
+
+public:
+    explicit EytzingerIndex(const Allocator &allocator = Allocator())
+            : keys(allocator), ranks(RankAllocator(allocator)) {}
+
+    template<typename Storage>
+    void build(const Storage &sorted) {
+        keys.assign(sorted.size() + 1, T{});
+        ranks.assign(sorted.size() + 1, 0);
+        std::size_t next = 0;
+        fill(sorted, next, 1);
+    }
+
+    void clear() {
+        keys.clear();
+        ranks.clear();
+    }
+
+    [[nodiscard]] std::size_t size() const { return keys.empty() ? 0 : keys.size() - 1; }
+
+    [[nodiscard]] std::size_t lowerBound(T value) const { return rank<false>(value); }
+
+    [[nodiscard]] std::size_t upperBound(T value) const { return rank<true>(value); }
+
+    // Answered from the index alone, without touching the sorted run
+    [[nodiscard]] bool contains(T value) const {
+        auto node = search<false>(value);
+        return node != 0 && keys[node] == value;
+    }
+};
+
+#endif  // SORTEDSTORAGE_H
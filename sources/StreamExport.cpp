@@ -0,0 +1,147 @@
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <memory>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "StreamExport.hpp"
+
+// Bytes staged per write for the orders that cannot be written in place
+static const std::size_t STAGING_BYTES = std::size_t{1} << 20;
+// Runs handed to one writev call; well under every platform's IOV_MAX
+static const std::size_t RUNS_PER_WRITE = 512;
+// Widest decimal value plus its newline: a sign and 20 digits
+static const std::size_t MAX_TEXT_BYTES = 22;
+
+// Writes every byte of the vectors, resuming after short or interrupted writes
+static void writeAll(int descriptor, iovec *vectors, std::size_t count) {
+    while (count > 0) {
+        auto written = ::writev(descriptor, vectors, static_cast<int>(count));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "write failed");
+        }
+        auto remaining = static_cast<std::size_t>(written);
+        while (count > 0 && remaining >= vectors->iov_len) {
+            remaining -= vectors->iov_len;
+            ++vectors;
+            --count;
+        }
+        if (count > 0) {
+            vectors->iov_base = static_cast<char *>(vectors->iov_base) + remaining;
+            vectors->iov_len -= remaining;
+        }
+    }
+}
+
+static void writeAll(int descriptor, const char *data, std::size_t size) {
+    iovec vector{const_cast<char *>(data), size};
+    writeAll(descriptor, &vector, 1);
+}
+
+template<typename T, typename Allocator>
+static void writeRunsInPlace(const BasicMagicalContainer<T, Allocator> &container, int descriptor, MagicalOrder order) {
+    std::vector<iovec> vectors;
+    vectors.reserve(RUNS_PER_WRITE);
+    container.forEachRun(order, [&](const T *run, std::size_t length) {
+        if (length > 0) {
+            vectors.push_back({const_cast<T *>(run), length * sizeof(T)});
+        }
+        if (vectors.size() == RUNS_PER_WRITE) {
+            writeAll(descriptor, vectors.data(), vectors.size());
+            vectors.clear();
+        }
+    });
+    writeAll(descriptor, vectors.data(), vectors.size());
+}
+
+template<typename T, typename Allocator>
+std::size_t exportToDescriptor(const BasicMagicalContainer<T, Allocator> &container, int descriptor, MagicalOrder order,
+                               LoadFormat format) {
+    bool inPlace = format == LoadFormat::Binary && order != MagicalOrder::SideCross &&
+                   std::endian::native == std::endian::little && BasicMagicalContainer<T, Allocator>::stableRuns;
+    if (inPlace) {
+        std::size_t total = 0;
+        container.forEachRun(order, [&total](const T *, std::size_t length) { total += length; });
+        writeRunsInPlace(container, descriptor, order);
+        return total;
+    }
+
+    // Values are gathered a chunk at a time, then written raw or formatted one per line
+    std::size_t chunkValues =
+            format == LoadFormat::Binary ? STAGING_BYTES / sizeof(T) : STAGING_BYTES / MAX_TEXT_BYTES;
+    std::unique_ptr<T[]> values(new T[chunkValues]);
+    std::unique_ptr<char[]> text(format == LoadFormat::Text ? new char[chunkValues * MAX_TEXT_BYTES] : nullptr);
+    std::size_t from = 0;
+    while (true) {
+        auto count = container.exportTo(std::span<T>(values.get(), chunkValues), order, from);
+        if (count == 0) {
+            return from;
+        }
+        from += count;
+        if (format == LoadFormat::Binary) {
+            if constexpr (std::endian::native == std::endian::big) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    auto *bytes = reinterpret_cast<char *>(values.get() + i);
+                    std::reverse(bytes, bytes + sizeof(T));
+                }
+            }
+            writeAll(descriptor, reinterpret_cast<const char *>(values.get()), count * sizeof(T));
+        } else {
+            char *cursor = text.get();
+            for (std::size_t i = 0; i < count; ++i) {
+                cursor = std::to_chars(cursor, cursor + MAX_TEXT_BYTES, values[i]).ptr;
+                *cursor++ = '\n';
+            }
+            writeAll(descriptor, text.get(), static_cast<std::size_t>(cursor - text.get()));
+        }
+    }
+}
+
+template<typename T, typename Allocator>
+std::size_t exportToFile(const BasicMagicalContainer<T, Allocator> &container, const std::string &path,
+                         MagicalOrder order, LoadFormat format) {
+    if (path == "-") {
+        return exportToDescriptor(container, STDOUT_FILENO, order, format);
+    }
+    int descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (descriptor < 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot create " + path);
+    }
+    std::size_t count = 0;
+    try {
+        count = exportToDescriptor(container, descriptor, order, format);
+    } catch (...) {
+        ::close(descriptor);
+        throw;
+    }
+    // Some filesystems only report a failed write at close
+    if (::close(descriptor) != 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot close " + path);
+    }
+    return count;
+}
+
+template std::size_t exportToDescriptor(const BasicMagicalContainer<std::int32_t> &, int, MagicalOrder, LoadFormat);
+template std::size_t exportToDescriptor(const BasicMagicalContainer<std::int64_t> &, int, MagicalOrder, LoadFormat);
+template std::size_t exportToDescriptor(const BasicMagicalContainer<std::uint64_t> &, int, MagicalOrder, LoadFormat);
+template std::size_t exportToDescriptor(const PmrBasicMagicalContainer<std::int32_t> &, int, MagicalOrder, LoadFormat);
+template std::size_t exportToDescriptor(const PmrBasicMagicalContainer<std::int64_t> &, int, MagicalOrder, LoadFormat);
+template std::size_t exportToDescriptor(const PmrBasicMagicalContainer<std::uint64_t> &, int, MagicalOrder, LoadFormat);
+template std::size_t exportToFile(const BasicMagicalContainer<std::int32_t> &, const std::string &, MagicalOrder,
+                                  LoadFormat);
+template std::size_t exportToFile(const BasicMagicalContainer<std::int64_t> &, const std::string &, MagicalOrder,
+                                  LoadFormat);
+template std::size_t exportToFile(const BasicMagicalContainer<std::uint64_t> &, const std::string &, MagicalOrder,
+                                  LoadFormat);
+template std::size_t exportToFile(const PmrBasicMagicalContainer<std::int32_t> &, const std::string &, MagicalOrder,
+                                  LoadFormat);
+template std::size_t exportToFile(const PmrBasicMagicalContainer<std::int64_t> &, const std::string &, MagicalOrder,
+                                  LoadFormat);
+template std::size_t exportToFile(const PmrBasicMagicalContainer<std::uint64_t> &, const std::string &, MagicalOrder,
+                                  LoadFormat);
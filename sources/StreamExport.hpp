@@ -0,0 +1,48 @@
+#ifndef STREAMEXPORT_H
+#define STREAMEXPORT_H
+
+#include <cstddef>
+#include <string>
+#include "MagicalContainer.hpp"
+#include "StreamLoader.hpp"
+
+// Writes one of the container's orders to a descriptor in a form loadFromDescriptor reads back: one
+// decimal value per line, or raw native-order values. Binary ascending and prime exports hand the storage
+// runs straight to writev, so nothing is copied in user space; the cross order, text and the packed
+// backend, whose runs are decoded copies, are staged through a buffer of about a megabyte per write.
+// Returns the number of values written. Throws std::system_error if a write fails.
+template<typename T, typename Allocator>
+std::size_t exportToDescriptor(const BasicMagicalContainer<T, Allocator> &container, int descriptor, MagicalOrder order,
+                               LoadFormat format);
+
+// Creates or truncates path, or writes to standard output when path is "-"
+template<typename T, typename Allocator>
+std::size_t exportToFile(const BasicMagicalContainer<T, Allocator> &container, const std::string &path,
+                         MagicalOrder order, LoadFormat format);
+
+extern template std::size_t exportToDescriptor(const BasicMagicalContainer<std::int32_t> &, int, MagicalOrder,
+                                               LoadFormat);
+extern template std::size_t exportToDescriptor(const BasicMagicalContainer<std::int64_t> &, int, MagicalOrder,
+                                               LoadFormat);
+extern template std::size_t exportToDescriptor(const BasicMagicalContainer<std::uint64_t> &, int, MagicalOrder,
+                                               LoadFormat);
+extern template std::size_t exportToDescriptor(const PmrBasicMagicalContainer<std::int32_t> &, int, MagicalOrder,
+                                               LoadFormat);
+extern template std::size_t exportToDescriptor(const PmrBasicMagicalContainer<std::int64_t> &, int, MagicalOrder,
+                                               LoadFormat);
+extern template std::size_t exportToDescriptor(const PmrBasicMagicalContainer<std::uint64_t> &, int, MagicalOrder,
+                                               LoadFormat);
+extern template std::size_t exportToFile(const BasicMagicalContainer<std::int32_t> &, const std::string &,
+                                         MagicalOrder, LoadFormat);
+extern template std::size_t exportToFile(const BasicMagicalContainer<std::int64_t> &, const std::string &,
+                                         MagicalOrder, LoadFormat);
+extern template std::size_t exportToFile(const BasicMagicalContainer<std::uint64_t> &, const std::string &,
+                                         MagicalOrder, LoadFormat);
+extern template std::size_t exportToFile(const PmrBasicMagicalContainer<std::int32_t> &, const std::string &,
+                                         MagicalOrder, LoadFormat);
+extern template std::size_t exportToFile(const PmrBasicMagicalContainer<std::int64_t> &, const std::string &,
+                                         MagicalOrder, LoadFormat);
+extern template std::size_t exportToFile(const PmrBasicMagicalContainer<std::uint64_t> &, const std::string &,
+                                         MagicalOrder, LoadFormat);
+
+#endif  // STREAMEXPORT_H
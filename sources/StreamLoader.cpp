@@ -0,0 +1,244 @@
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include "StreamLoader.hpp"
+
+// Bytes requested from the kernel per read
+static const std::size_t CHUNK_BYTES = std::size_t{1} << 20;
+// Smallest batch worth a sort and merge; later batches grow with the container
+static const std::size_t MIN_BATCH_VALUES = std::size_t{1} << 16;
+// Longest text token that can straddle two chunks: a sign, 20 digits and some leading zeros
+static const std::size_t MAX_TOKEN_BYTES = 64;
+
+static const std::uint64_t ASCII_ZEROS = 0x3030303030303030ULL;
+
+// Fills buffer with up to size bytes, retrying interrupted reads. Returns 0 only at end of input.
+static std::size_t readSome(int descriptor, char *buffer, std::size_t size) {
+    while (true) {
+        auto count = ::read(descriptor, buffer, size);
+        if (count >= 0) {
+            return static_cast<std::size_t>(count);
+        }
+        if (errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "read failed");
+        }
+    }
+}
+
+// True when all eight bytes of a little-endian load are ASCII digits
+static bool allDigits(std::uint64_t chunk) {
+    return (((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4U)) == 0x3333333333333333ULL);
+}
+
+// Value of eight ASCII digits from a little-endian load, combined pairwise in three multiplies
+static std::uint64_t parseEightDigits(std::uint64_t chunk) {
+    chunk -= ASCII_ZEROS;
+    chunk = chunk * 10 + (chunk >> 8U);
+    chunk = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32U))) +
+             (((chunk >> 16U) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32U)))) >> 32U;
+    return chunk;
+}
+
+static bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+static bool isSeparator(char c) { return c == '\n' || c == ',' || c == ' ' || c == '\r' || c == '\t'; }
+
+template<typename T>
+static T toElement(bool negative, std::uint64_t magnitude) {
+    if (negative) {
+        if constexpr (std::is_signed_v<T>) {
+            if (magnitude <= static_cast<std::uint64_t>(std::numeric_limits<T>::max()) + 1) {
+                return static_cast<T>(-static_cast<std::int64_t>(magnitude - 1) - 1);
+            }
+        } else if (magnitude == 0) {
+            return T{0};
+        }
+    } else if (magnitude <= static_cast<std::uint64_t>(std::numeric_limits<T>::max())) {
+        return static_cast<T>(magnitude);
+    }
+    throw std::runtime_error("value out of range for the element type");
+}
+
+// Collects parsed values and merges them into the container once a batch is as large as the container
+template<typename T, typename Allocator>
+class BatchSink {
+private:
+    BasicMagicalContainer<T, Allocator> &container;
+    std::vector<T> batch;
+    std::size_t threshold;
+    std::size_t total = 0;
+
+public:
+    explicit BatchSink(BasicMagicalContainer<T, Allocator> &cont)
+            : container(cont), threshold(std::max(MIN_BATCH_VALUES, static_cast<std::size_t>(cont.size()))) {}
+
+    void push(T value) {
+        batch.push_back(value);
+        if (batch.size() >= threshold) [[unlikely]] {
+            flush();
+        }
+    }
+
+    // Appends count values stored as raw native-order bytes
+    void append(const char *bytes, std::size_t count) {
+        auto used = batch.size();
+        batch.resize(used + count);
+        std::memcpy(batch.data() + used, bytes, count * sizeof(T));
+        if (batch.size() >= threshold) {
+            flush();
+        }
+    }
+
+    void flush() {
+        total += batch.size();
+        if (!batch.empty()) {
+            container.addElements(std::move(batch));
+        }
+        threshold = std::max(MIN_BATCH_VALUES, static_cast<std::size_t>(container.size()));
+        batch = std::vector<T>();
+    }
+
+    [[nodiscard]] std::size_t count() const { return total + batch.size(); }
+};
+
+// Parses every complete number in [cursor, end) into sink. A number that touches end may continue in the
+// next chunk, so unless this is the last chunk parsing stops there and the start of it is returned.
+template<typename T, typename Allocator>
+static const char *parseText(const char *cursor, const char *end, bool last, BatchSink<T, Allocator> &sink) {
+    while (true) {
+        while (cursor != end && isSeparator(*cursor)) {
+            ++cursor;
+        }
+        if (cursor == end) {
+            return cursor;
+        }
+        const char *start = cursor;
+        bool negative = *cursor == '-';
+        cursor += negative ? 1 : 0;
+        std::uint64_t magnitude = 0;
+        if constexpr (std::endian::native == std::endian::little) {
+            std::uint64_t chunk = 0;
+            if (end - cursor >= 8 && (std::memcpy(&chunk, cursor, sizeof(chunk)), allDigits(chunk))) {
+                magnitude = parseEightDigits(chunk);
+                cursor += 8;
+            }
+        }
+        while (cursor != end && isDigit(*cursor)) {
+            if (__builtin_mul_overflow(magnitude, 10U, &magnitude) ||
+                __builtin_add_overflow(magnitude, static_cast<unsigned>(*cursor - '0'), &magnitude)) {
+                throw std::runtime_error("value out of range for the element type");
+            }
+            ++cursor;
+        }
+        if (cursor == end && !last) {
+            return start;
+        }
+        if (cursor == start + (negative ? 1 : 0) || (cursor != end && !isSeparator(*cursor))) {
+            throw std::runtime_error("unexpected character in integer text");
+        }
+        sink.push(toElement<T>(negative, magnitude));
+    }
+}
+
+template<typename T, typename Allocator>
+static void loadText(int descriptor, BatchSink<T, Allocator> &sink) {
+    // Left uninitialized: read() overwrites it before anything looks at it
+    std::unique_ptr<char[]> buffer(new char[MAX_TOKEN_BYTES + CHUNK_BYTES]);
+    std::size_t carried = 0;
+    while (true) {
+        auto count = readSome(descriptor, buffer.get() + carried, CHUNK_BYTES);
+        const char *end = buffer.get() + carried + count;
+        const char *rest = parseText(buffer.get(), end, count == 0, sink);
+        carried = static_cast<std::size_t>(end - rest);
+        if (count == 0) {
+            return;
+        }
+        if (carried > MAX_TOKEN_BYTES) {
+            throw std::runtime_error("integer text token too long");
+        }
+        std::memmove(buffer.get(), rest, carried);
+    }
+}
+
+template<typename T, typename Allocator>
+static void loadBinary(int descriptor, BatchSink<T, Allocator> &sink) {
+    std::unique_ptr<char[]> buffer(new char[CHUNK_BYTES]);
+    std::size_t carried = 0;
+    while (true) {
+        auto count = readSome(descriptor, buffer.get() + carried, CHUNK_BYTES - carried);
+        if (count == 0) {
+            if (carried != 0) {
+                throw std::runtime_error("binary input ends inside a value");
+            }
+            return;
+        }
+        carried += count;
+        auto values = carried / sizeof(T);
+        if constexpr (std::endian::native == std::endian::big) {
+            for (std::size_t i = 0; i < values; ++i) {
+                std::reverse(buffer.get() + i * sizeof(T), buffer.get() + (i + 1) * sizeof(T));
+            }
+        }
+        sink.append(buffer.get(), values);
+        std::memmove(buffer.get(), buffer.get() + values * sizeof(T), carried - values * sizeof(T));
+        carried -= values * sizeof(T);
+    }
+}
+
+template<typename T, typename Allocator>
+std::size_t loadFromDescriptor(BasicMagicalContainer<T, Allocator> &container, int descriptor, LoadFormat format) {
+    BatchSink<T, Allocator> sink(container);
+    try {
+        if (format == LoadFormat::Text) {
+            loadText(descriptor, sink);
+        } else {
+            loadBinary(descriptor, sink);
+        }
+    } catch (...) {
+        // Keep what was parsed before the error, as documented, instead of dropping the pending batch
+        sink.flush();
+        throw;
+    }
+    sink.flush();
+    return sink.count();
+}
+
+template<typename T, typename Allocator>
+std::size_t loadFromFile(BasicMagicalContainer<T, Allocator> &container, const std::string &path, LoadFormat format) {
+    if (path == "-") {
+        return loadFromDescriptor(container, STDIN_FILENO, format);
+    }
+    int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+    }
+    ::posix_fadvise(descriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+    try {
+        auto count = loadFromDescriptor(container, descriptor, format);
+        ::close(descriptor);
+        return count;
+    } catch (...) {
+        ::close(descriptor);
+        throw;
+    }
+}
+
+template std::size_t loadFromDescriptor(BasicMagicalContainer<std::int32_t> &, int, LoadFormat);
+template std::size_t loadFromDescriptor(BasicMagicalContainer<std::int64_t> &, int, LoadFormat);
+template std::size_t loadFromDescriptor(BasicMagicalContainer<std::uint64_t> &, int, LoadFormat);
+template std::size_t loadFromDescriptor(PmrBasicMagicalContainer<std::int32_t> &, int, LoadFormat);
+template std::size_t loadFromDescriptor(PmrBasicMagicalContainer<std::int64_t> &, int, LoadFormat);
+template std::size_t loadFromDescriptor(PmrBasicMagicalContainer<std::uint64_t> &, int, LoadFormat);
+template std::size_t loadFromFile(BasicMagicalContainer<std::int32_t> &, const std::string &, LoadFormat);
+template std::size_t loadFromFile(BasicMagicalContainer<std::int64_t> &, const std::string &, LoadFormat);
+template std::size_t loadFromFile(BasicMagicalContainer<std::uint64_t> &, const std::string &, LoadFormat);
+template std::size_t loadFromFile(PmrBasicMagicalContainer<std::int32_t> &, const std::string &, LoadFormat);
+template std::size_t loadFromFile(PmrBasicMagicalContainer<std::int64_t> &, const std::string &, LoadFormat);
+template std::size_t loadFromFile(PmrBasicMagicalContainer<std::uint64_t> &, const std::string &, LoadFormat);
@@ -0,0 +1,38 @@
+#ifndef STREAMLOADER_H
+#define STREAMLOADER_H
+
+#include <cstddef>
+#include <string>
+#include "MagicalContainer.hpp"
+
+enum class LoadFormat {
+    Text,   // decimal integers separated by whitespace or commas, so one per line and CSV both work
+    Binary  // raw little-endian values of the container's element width
+};
+
+// Reads a whole input in large chunks and feeds it to the container in sorted, merged batches. A batch
+// grows to at least the size of the container before it is merged, so a load moves every element a
+// constant number of times however large the input. Returns the number of values added. Throws
+// std::runtime_error for malformed input, a value outside the element range or a truncated binary value,
+// and std::system_error if reading fails; every complete value parsed before the error is still added.
+template<typename T, typename Allocator>
+std::size_t loadFromDescriptor(BasicMagicalContainer<T, Allocator> &container, int descriptor, LoadFormat format);
+
+// Opens path, or reads standard input when path is "-"
+template<typename T, typename Allocator>
+std::size_t loadFromFile(BasicMagicalContainer<T, Allocator> &container, const std::string &path, LoadFormat format);
+
+extern template std::size_t loadFromDescriptor(BasicMagicalContainer<std::int32_t> &, int, LoadFormat);
+extern template std::size_t loadFromDescriptor(BasicMagicalContainer<std::int64_t> &, int, LoadFormat);
+extern template std::size_t loadFromDescriptor(BasicMagicalContainer<std::uint64_t> &, int, LoadFormat);
+extern template std::size_t loadFromDescriptor(PmrBasicMagicalContainer<std::int32_t> &, int, LoadFormat);
+extern template std::size_t loadFromDescriptor(PmrBasicMagicalContainer<std::int64_t> &, int, LoadFormat);
+extern template std::size_t loadFromDescriptor(PmrBasicMagicalContainer<std::uint64_t> &, int, LoadFormat);
+extern template std::size_t loadFromFile(BasicMagicalContainer<std::int32_t> &, const std::string &, LoadFormat);
+extern template std::size_t loadFromFile(BasicMagicalContainer<std::int64_t> &, const std::string &, LoadFormat);
+extern template std::size_t loadFromFile(BasicMagicalContainer<std::uint64_t> &, const std::string &, LoadFormat);
+extern template std::size_t loadFromFile(PmrBasicMagicalContainer<std::int32_t> &, const std::string &, LoadFormat);
+extern template std::size_t loadFromFile(PmrBasicMagicalContainer<std::int64_t> &, const std::string &, LoadFormat);
+extern template std::size_t loadFromFile(PmrBasicMagicalContainer<std::uint64_t> &, const std::string &, LoadFormat);
+
+#endif  // STREAMLOADER_H
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for (std::thread &worker: workers) {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::threadCount() const {
+    return static_cast<unsigned>(workers.size());
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        taskReady.wait(guard, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+        std::function<void()> task = std::move(queue.front());
+        queue.pop_front();
+        guard.unlock();
+        std::exception_ptr thrown;
+        try {
+            task();
+        } catch (...) {
+            thrown = std::current_exception();
+        }
+        guard.lock();
+        if (thrown && !failure) {
+            failure = thrown;
+        }
+        if (--pending == 0) {
+            batchDone.notify_all();
+        }
+    }
+}
+
+void ThreadPool::run(std::vector<std::function<void()>> tasks) {
+    std::lock_guard<std::mutex> batch(batchLock);
+    std::unique_lock<std::mutex> guard(lock);
+    pending += tasks.size();
+    for (std::function<void()> &task: tasks) {
+        queue.push_back(std::move(task));
+    }
+    taskReady.notify_all();
+    batchDone.wait(guard, [this] { return pending == 0; });
+    std::exception_ptr thrown = failure;
+    failure = nullptr;
+    if (thrown) {
+        std::rethrow_exception(thrown);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run batches of tasks fork-join style
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex lock;
+    std::mutex batchLock;           // held by run() for its whole batch, since pending and failure are per batch
+    std::condition_variable taskReady;
+    std::condition_variable batchDone;
+    std::size_t pending = 0;        // tasks of the current batch not finished yet
+    std::exception_ptr failure;     // first exception thrown by a task of the current batch
+    bool stopping = false;
+
+    void workerLoop();
+
+public:
+    // Zero picks one worker per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool();
+
+    [[nodiscard]] unsigned threadCount() const;
+
+    // Runs every task and returns once all of them finished, rethrowing the first exception any of them threw.
+    // Calls from several threads are safe but take turns, one whole batch at a time; a task must not call it.
+    void run(std::vector<std::function<void()>> tasks);
+};
+
+#endif  // THREADPOOL_H